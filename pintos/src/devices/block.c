@@ -3,7 +3,11 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* A block device. */
 struct block
@@ -17,8 +21,49 @@ struct block
     const struct block_operations *ops;  /* Driver operations. */
     void *aux;                          /* Extra data owned by driver. */
 
-    unsigned long long read_cnt;        /* Number of sectors read. */
-    unsigned long long write_cnt;       /* Number of sectors written. */
+    struct block_stats stats;           /* I/O statistics. */
+
+    /* Request queue, protected by the dispatcher's lock. */
+    struct block_dispatcher *dispatcher; /* Null to run requests
+                                            synchronously. */
+    struct list_elem dispatcher_elem;   /* In dispatcher's BLOCKS. */
+    struct list queue;                  /* Pending requests, by sector. */
+    block_sector_t next_sector;         /* Where the last dispatched
+                                           request ended. */
+  };
+
+/* Request scheduling.
+
+   A block device with a dispatcher keeps its pending requests in
+   a queue sorted by sector.  The dispatcher thread serves them in
+   C-SCAN order: upward from where the last request ended, then
+   back around to the lowest sector.  A request that is past its
+   deadline goes first instead, so that a stream of nearby
+   requests cannot starve a distant one.  Reads have the shorter
+   deadline, since a thread is usually waiting for them.
+
+   Requests in the same direction for adjacent sectors are merged
+   into one transfer of up to MERGE_MAX sectors, through a bounce
+   buffer.
+
+   One dispatcher may serve several devices that cannot transfer
+   at the same time, such as the disks on an IDE channel.  It
+   takes turns among those with pending requests. */
+#define READ_DEADLINE (TIMER_FREQ / 10)         /* 100 ms. */
+#define WRITE_DEADLINE TIMER_FREQ               /* 1 s. */
+#define MERGE_PAGES 4
+#define MERGE_MAX (MERGE_PAGES * PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A dispatcher thread and the devices it serves. */
+struct block_dispatcher
+  {
+    struct lock lock;                   /* Protects the device queues. */
+    struct condition work;              /* Signaled when a request is
+                                           queued. */
+    struct list blocks;                 /* Devices served, the next to
+                                           get a turn first. */
+    uint8_t *bounce;                    /* MERGE_MAX sectors, or null
+                                           if requests are not merged. */
   };
 
 /* List of all block devices. */
@@ -28,6 +73,13 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static inline uint64_t rdtsc (void);
+static void device_io (struct block *, block_sector_t, size_t cnt,
+                       void *buffer, bool write);
+static void complete (struct block_request *);
+static void account_transfer (struct block *, block_sector_t, size_t cnt);
+static void account_completion (struct block *, struct block_request *);
+static thread_func dispatcher_thread NO_RETURN;
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -113,6 +165,18 @@ check_sector (struct block *block, block_sector_t sector)
     }
 }
 
+/* Verifies that the CNT sectors starting at SECTOR all lie
+   within BLOCK.  Panics if not. */
+static void
+check_sectors (struct block *block, block_sector_t sector, size_t cnt)
+{
+  check_sector (block, sector);
+  if (cnt > block->size - sector)
+    PANIC ("Access past end of device %s (sector=%"PRDSNu", cnt=%zu, "
+           "size=%"PRDSNu")\n", block_name (block), sector, cnt,
+           block->size);
+}
+
 /* Reads sector SECTOR from BLOCK into BUFFER, which must
    have room for BLOCK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to block devices, so external
@@ -120,9 +184,7 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
-  check_sector (block, sector);
-  block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  block_read_multi (block, sector, 1, buffer);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -133,10 +195,187 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
-  check_sector (block, sector);
-  ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  block_write_multi (block, sector, 1, buffer);
+}
+
+/* Reads the CNT sectors starting at SECTOR from BLOCK into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  Drivers that support it transfer them with as few
+   commands as possible.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_read_multi (struct block *block, block_sector_t sector, size_t cnt,
+                  void *buffer)
+{
+  struct block_request r;
+
+  block_request_init (&r, sector, cnt, buffer, false, NULL, NULL);
+  block_submit (block, &r);
+  block_wait (&r);
+}
+
+/* Writes the CNT sectors starting at SECTOR to BLOCK from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the block device has acknowledged receiving all
+   of the data.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_write_multi (struct block *block, block_sector_t sector, size_t cnt,
+                   const void *buffer)
+{
+  struct block_request r;
+
+  block_request_init (&r, sector, cnt, (void *) buffer, true, NULL, NULL);
+  block_submit (block, &r);
+  block_wait (&r);
+}
+
+/* Initializes R as a request to transfer CNT sectors starting at
+   SECTOR between a block device and BUFFER: into BUFFER if WRITE
+   is false, out of it if WRITE is true.  If COMPLETE is non-null,
+   it is called with R, whose AUX member is set to AUX, when the
+   request completes, possibly in another thread; it must not
+   wait for block I/O.  Otherwise, block_wait() waits for R to
+   complete. */
+void
+block_request_init (struct block_request *r, block_sector_t sector,
+                    size_t cnt, void *buffer, bool write,
+                    block_complete_func *complete, void *aux)
+{
+  r->sector = sector;
+  r->cnt = cnt;
+  r->buffer = buffer;
+  r->write = write;
+  r->complete = complete;
+  r->aux = aux;
+  sema_init (&r->done, 0);
+}
+
+/* Returns true if request A's first sector precedes request
+   B's. */
+static bool
+request_less (const struct list_elem *a_, const struct list_elem *b_,
+              void *aux UNUSED)
+{
+  const struct block_request *a = list_entry (a_, struct block_request, elem);
+  const struct block_request *b = list_entry (b_, struct block_request, elem);
+
+  return a->sector < b->sector;
+}
+
+/* Submits request R, initialized with block_request_init(), to
+   BLOCK and returns without waiting for it unless BLOCK has no
+   dispatcher, in which case R is carried out, and completes,
+   before returning.  Pending requests for overlapping sectors
+   may be carried out in any order. */
+void
+block_submit (struct block *block, struct block_request *r)
+{
+  struct block_dispatcher *d = block->dispatcher;
+
+  if (r->cnt == 0)
+    {
+      complete (r);
+      return;
+    }
+  check_sectors (block, r->sector, r->cnt);
+  if (r->write)
+    {
+      ASSERT (block->type != BLOCK_FOREIGN);
+      block->stats.write_cnt += r->cnt;
+    }
+  else
+    block->stats.read_cnt += r->cnt;
+  r->submitted = rdtsc ();
+
+  if (d == NULL)
+    {
+      account_transfer (block, r->sector, r->cnt);
+      device_io (block, r->sector, r->cnt, r->buffer, r->write);
+      account_completion (block, r);
+      complete (r);
+      return;
+    }
+
+  r->deadline = timer_ticks () + (r->write ? WRITE_DEADLINE : READ_DEADLINE);
+  lock_acquire (&d->lock);
+  list_insert_ordered (&block->queue, &r->elem, request_less, NULL);
+  cond_signal (&d->work, &d->lock);
+  lock_release (&d->lock);
+}
+
+/* Waits for request R, which must not have a completion
+   function, to complete. */
+void
+block_wait (struct block_request *r)
+{
+  ASSERT (r->complete == NULL);
+  sema_down (&r->done);
+}
+
+/* Signals that request R has completed. */
+static void
+complete (struct block_request *r)
+{
+  if (r->complete != NULL)
+    r->complete (r);
+  else
+    sema_up (&r->done);
+}
+
+/* Counts a transfer of CNT sectors starting at SECTOR, about to
+   be handed to BLOCK's driver, in BLOCK's statistics. */
+static void
+account_transfer (struct block *block, block_sector_t sector, size_t cnt)
+{
+  block->stats.transfer_cnt++;
+  if (sector == block->next_sector)
+    block->stats.seq_cnt++;
+  block->next_sector = sector + cnt;
+}
+
+/* Counts request R, which is about to complete, in BLOCK's
+   latency histogram. */
+static void
+account_completion (struct block *block, struct block_request *r)
+{
+  uint64_t latency = rdtsc () - r->submitted;
+  int bucket = 0;
+
+  while (latency > 1 && bucket < BLOCK_LATENCY_BUCKETS - 1)
+    {
+      latency >>= 1;
+      bucket++;
+    }
+  block->stats.request_cnt[r->write]++;
+  block->stats.latency[r->write][bucket]++;
+}
+
+/* Transfers CNT sectors starting at SECTOR between BLOCK and
+   BUFFER by calling its driver directly. */
+static void
+device_io (struct block *block, block_sector_t sector, size_t cnt,
+           void *buffer_, bool write)
+{
+  uint8_t *buffer = buffer_;
+  uint64_t start = rdtsc ();
+  size_t i;
+
+  if (write && block->ops->write_multi != NULL)
+    block->ops->write_multi (block->aux, sector, cnt, buffer);
+  else if (!write && block->ops->read_multi != NULL)
+    block->ops->read_multi (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      if (write)
+        block->ops->write (block->aux, sector + i,
+                           buffer + i * BLOCK_SECTOR_SIZE);
+      else
+        block->ops->read (block->aux, sector + i,
+                          buffer + i * BLOCK_SECTOR_SIZE);
+  block->stats.service_total += rdtsc () - start;
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -170,14 +409,60 @@ block_print_stats (void)
     {
       struct block *block = block_by_role[i];
       if (block != NULL)
-        {
-          printf ("%s (%s): %llu reads, %llu writes\n",
-                  block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
-        }
+        block_print_device_stats (block, "");
     }
 }
 
+/* Copies BLOCK's statistics into *STATS.  The copy may be
+   slightly inconsistent if requests complete meanwhile. */
+void
+block_get_stats (struct block *block, struct block_stats *stats)
+{
+  *stats = block->stats;
+}
+
+/* Prints statistics for BLOCK, preceding each line with
+   INDENT. */
+void
+block_print_device_stats (struct block *block, const char *indent)
+{
+  struct block_stats s;
+  unsigned long long request_cnt;
+  int write, i;
+
+  block_get_stats (block, &s);
+  printf ("%s%s (%s): %llu reads, %llu writes\n",
+          indent, block->name, block_type_name (block->type),
+          s.read_cnt, s.write_cnt);
+
+  request_cnt = s.request_cnt[0] + s.request_cnt[1];
+  if (request_cnt > 0 && s.transfer_cnt > 0)
+    {
+      printf ("%s  %llu bytes read, %llu bytes written, "
+              "%llu transfers (%llu%% sequential)\n",
+              indent, s.read_cnt * BLOCK_SECTOR_SIZE,
+              s.write_cnt * BLOCK_SECTOR_SIZE, s.transfer_cnt,
+              s.seq_cnt * 100 / s.transfer_cnt);
+      printf ("%s  queue wait: %llu avg, %llu max; "
+              "service: %llu avg per transfer (cycles)\n",
+              indent, s.wait_total / request_cnt, s.wait_max,
+              s.service_total / s.transfer_cnt);
+      for (write = 0; write < 2; write++)
+        if (s.request_cnt[write] > 0)
+          {
+            printf ("%s  %s latency (log2 cycles: requests):",
+                    indent, write ? "write" : "read");
+            for (i = 0; i < BLOCK_LATENCY_BUCKETS; i++)
+              if (s.latency[write][i] > 0)
+                printf (" %d:%llu", i, s.latency[write][i]);
+            printf ("\n");
+          }
+    }
+
+  if (block->ops->print_stats != NULL)
+    block->ops->print_stats (block->aux);
+}
+
 /* Registers a new block device with the given NAME.  If
    EXTRA_INFO is non-null, it is printed as part of a user
    message.  The block device's SIZE in sectors and its TYPE must
@@ -198,8 +483,10 @@ block_register (const char *name, enum block_type type,
   block->size = size;
   block->ops = ops;
   block->aux = aux;
-  block->read_cnt = 0;
-  block->write_cnt = 0;
+  memset (&block->stats, 0, sizeof block->stats);
+  block->dispatcher = NULL;
+  list_init (&block->queue);
+  block->next_sector = 0;
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -211,6 +498,15 @@ block_register (const char *name, enum block_type type,
   return block;
 }
 
+/* Returns the processor's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 /* Returns the block device corresponding to LIST_ELEM, or a null
    pointer if LIST_ELEM is the list end of all_blocks. */
 static struct block *
@@ -221,3 +517,199 @@ list_elem_to_block (struct list_elem *list_elem)
           : NULL);
 }
 
+
+/* Creates a dispatcher thread named NAME to serve the request
+   queues of the block devices later given to
+   block_set_dispatcher(). */
+struct block_dispatcher *
+block_dispatcher_create (const char *name)
+{
+  struct block_dispatcher *d = malloc (sizeof *d);
+  if (d == NULL)
+    PANIC ("Failed to allocate memory for block dispatcher");
+
+  lock_init (&d->lock);
+  cond_init (&d->work);
+  list_init (&d->blocks);
+  d->bounce = palloc_get_multiple (0, MERGE_PAGES);
+  thread_create (name, PRI_MAX, dispatcher_thread, d);
+  return d;
+}
+
+/* Queues future requests for BLOCK to be carried out by
+   dispatcher D. */
+void
+block_set_dispatcher (struct block *block, struct block_dispatcher *d)
+{
+  lock_acquire (&d->lock);
+  list_push_back (&d->blocks, &block->dispatcher_elem);
+  block->dispatcher = d;
+  lock_release (&d->lock);
+}
+
+/* Returns the request that BLOCK's queue, which must not be
+   empty, should dispatch next: the one furthest past its
+   deadline, if any, otherwise the next in C-SCAN order. */
+static struct block_request *
+choose_request (struct block *block)
+{
+  struct block_request *lowest = NULL;
+  struct block_request *next = NULL;
+  struct block_request *late = NULL;
+  int64_t now = timer_ticks ();
+  struct list_elem *e;
+
+  for (e = list_begin (&block->queue); e != list_end (&block->queue);
+       e = list_next (e))
+    {
+      struct block_request *r = list_entry (e, struct block_request, elem);
+      if (lowest == NULL)
+        lowest = r;
+      if (next == NULL && r->sector >= block->next_sector)
+        next = r;
+      if (r->deadline <= now && (late == NULL || r->deadline < late->deadline))
+        late = r;
+    }
+  return late != NULL ? late : next != NULL ? next : lowest;
+}
+
+/* Counts the time request R spent in BLOCK's queue, from which
+   it is being taken for dispatch, in BLOCK's statistics. */
+static void
+account_wait (struct block *block, struct block_request *r)
+{
+  uint64_t wait = rdtsc () - r->submitted;
+
+  block->stats.wait_total += wait;
+  if (wait > block->stats.wait_max)
+    block->stats.wait_max = wait;
+}
+
+/* Moves the next request to dispatch, along with the queued
+   requests that can be merged with it, to BATCH, in sector order.
+   Returns the device they are for, or a null pointer if no
+   device served by D has a pending request.  D's lock must be
+   held. */
+static struct block *
+take_batch (struct block_dispatcher *d, struct list *batch)
+{
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  for (e = list_begin (&d->blocks); e != list_end (&d->blocks);
+       e = list_next (e))
+    {
+      struct block *block = list_entry (e, struct block, dispatcher_elem);
+      struct block_request *r;
+      block_sector_t end;
+      size_t cnt;
+
+      if (list_empty (&block->queue))
+        continue;
+
+      /* Let the other devices go first next time. */
+      list_remove (&block->dispatcher_elem);
+      list_push_back (&d->blocks, &block->dispatcher_elem);
+
+      r = choose_request (block);
+      end = r->sector + r->cnt;
+      cnt = r->cnt;
+      e = list_next (&r->elem);
+      list_remove (&r->elem);
+      list_push_back (batch, &r->elem);
+      account_wait (block, r);
+
+      while (d->bounce != NULL && e != list_end (&block->queue))
+        {
+          struct block_request *next
+            = list_entry (e, struct block_request, elem);
+          if (next->sector != end || next->write != r->write
+              || cnt + next->cnt > MERGE_MAX)
+            break;
+          end += next->cnt;
+          cnt += next->cnt;
+          e = list_next (e);
+          list_remove (&next->elem);
+          list_push_back (batch, &next->elem);
+          account_wait (block, next);
+        }
+      account_transfer (block, r->sector, cnt);
+      return block;
+    }
+  return NULL;
+}
+
+/* Carries out the requests in BATCH, which take_batch() took
+   from BLOCK's queue, as a single transfer, and completes
+   them. */
+static void
+run_batch (struct block_dispatcher *d, struct block *block,
+           struct list *batch)
+{
+  struct block_request *first
+    = list_entry (list_front (batch), struct block_request, elem);
+  struct list_elem *e;
+
+  if (list_size (batch) == 1)
+    device_io (block, first->sector, first->cnt, first->buffer, first->write);
+  else
+    {
+      uint8_t *p = d->bounce;
+      size_t cnt = 0;
+
+      if (first->write)
+        for (e = list_begin (batch); e != list_end (batch); e = list_next (e))
+          {
+            struct block_request *r
+              = list_entry (e, struct block_request, elem);
+            memcpy (p, r->buffer, r->cnt * BLOCK_SECTOR_SIZE);
+            p += r->cnt * BLOCK_SECTOR_SIZE;
+          }
+      for (e = list_begin (batch); e != list_end (batch); e = list_next (e))
+        cnt += list_entry (e, struct block_request, elem)->cnt;
+
+      device_io (block, first->sector, cnt, d->bounce, first->write);
+
+      if (!first->write)
+        for (e = list_begin (batch); e != list_end (batch); e = list_next (e))
+          {
+            struct block_request *r
+              = list_entry (e, struct block_request, elem);
+            memcpy (r->buffer, p, r->cnt * BLOCK_SECTOR_SIZE);
+            p += r->cnt * BLOCK_SECTOR_SIZE;
+          }
+    }
+
+  /* A completion function may free its request. */
+  while (!list_empty (batch))
+    {
+      struct block_request *r = list_entry (list_pop_front (batch),
+                                            struct block_request, elem);
+      account_completion (block, r);
+      complete (r);
+    }
+}
+
+/* Dispatcher thread.  Waits for requests on the devices that
+   dispatcher D_ serves and carries them out one batch at a
+   time. */
+static void
+dispatcher_thread (void *d_)
+{
+  struct block_dispatcher *d = d_;
+
+  for (;;)
+    {
+      struct list batch;
+      struct block *block;
+
+      list_init (&batch);
+      lock_acquire (&d->lock);
+      while ((block = take_batch (d, &batch)) == NULL)
+        cond_wait (&d->work, &d->lock);
+      lock_release (&d->lock);
+
+      run_batch (d, block, &batch);
+    }
+}
@@ -2,7 +2,10 @@
 #define DEVICES_BLOCK_H
 
 #include <stddef.h>
+#include <stdbool.h>
 #include <inttypes.h>
+#include <list.h>
+#include "threads/synch.h"
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -53,22 +56,104 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_read_multi (struct block *, block_sector_t, size_t cnt, void *);
+void block_write_multi (struct block *, block_sector_t, size_t cnt,
+                        const void *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
+/* Asynchronous requests. */
+
+struct block_request;
+typedef void block_complete_func (struct block_request *);
+
+/* A request to transfer CNT sectors starting at SECTOR between a
+   block device and BUFFER.  The submitter provides the memory for
+   the request and must keep it and BUFFER valid until the request
+   completes. */
+struct block_request
+  {
+    /* Set by block_request_init(). */
+    block_sector_t sector;              /* First sector. */
+    size_t cnt;                         /* Number of sectors. */
+    void *buffer;                       /* CNT * BLOCK_SECTOR_SIZE bytes. */
+    bool write;                         /* Write rather than read? */
+    block_complete_func *complete;      /* Called on completion, or null
+                                           for block_wait(). */
+    void *aux;                          /* For COMPLETE's use. */
+
+    /* Owned by the block layer. */
+    struct list_elem elem;              /* In a request queue. */
+    int64_t deadline;                   /* Timer tick to dispatch by. */
+    uint64_t submitted;                 /* Time-stamp counter when
+                                           submitted. */
+    struct semaphore done;              /* Up'd on completion. */
+  };
+
+void block_request_init (struct block_request *, block_sector_t, size_t cnt,
+                         void *buffer, bool write,
+                         block_complete_func *, void *aux);
+void block_submit (struct block *, struct block_request *);
+void block_wait (struct block_request *);
+
 /* Statistics. */
+
+/* Number of latency histogram buckets.  Bucket I counts requests
+   that took between 2**I and 2**(I+1) - 1 time-stamp counter
+   cycles, except that the last bucket also counts all slower
+   ones. */
+#define BLOCK_LATENCY_BUCKETS 40
+
+/* Statistics for one block device.  Times are in time-stamp
+   counter cycles.  Requests for no sectors are not counted. */
+struct block_stats
+  {
+    unsigned long long read_cnt;        /* Number of sectors read. */
+    unsigned long long write_cnt;       /* Number of sectors written. */
+
+    /* Completed requests, indexed by WRITE. */
+    unsigned long long request_cnt[2];  /* Number of requests. */
+    unsigned long long latency[2][BLOCK_LATENCY_BUCKETS];
+                                        /* Histogram of time from
+                                           submission to completion. */
+
+    /* Time requests spent waiting for the dispatcher. */
+    uint64_t wait_total;                /* Sum over all requests. */
+    uint64_t wait_max;                  /* Longest single wait. */
+
+    /* Transfers handed to the driver, after merging. */
+    unsigned long long transfer_cnt;    /* Number of transfers. */
+    unsigned long long seq_cnt;         /* Transfers that began where
+                                           the previous one ended. */
+    uint64_t service_total;             /* Time spent in the driver. */
+  };
+
+void block_get_stats (struct block *, struct block_stats *);
 void block_print_stats (void);
+void block_print_device_stats (struct block *, const char *indent);
 
 /* Lower-level interface to block device drivers. */
 
+/* READ_MULTI and WRITE_MULTI transfer CNT consecutive sectors at
+   once.  A driver that cannot do better than one sector at a
+   time may leave them null.  PRINT_STATS, if non-null, prints
+   driver-specific statistics after the device's own. */
 struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+    void (*read_multi) (void *aux, block_sector_t, size_t cnt,
+                        void *buffer);
+    void (*write_multi) (void *aux, block_sector_t, size_t cnt,
+                         const void *buffer);
+    void (*print_stats) (void *aux);
   };
 
 struct block *block_register (const char *name, enum block_type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *, void *aux);
 
+struct block_dispatcher *block_dispatcher_create (const char *name);
+void block_set_dispatcher (struct block *, struct block_dispatcher *);
+
 #endif /* devices/block.h */
@@ -8,10 +8,15 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].  If the
+   controller is a PCI bus master, as QEMU's PIIX emulation is,
+   transfers use DMA as described in [SFF-8038i]; otherwise they
+   use PIO. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -34,6 +39,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +55,44 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+
+/* Bus master IDE register port addresses. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRD table. */
+
+/* Bus master command register bits. */
+#define BM_START 0x01           /* Start transfer. */
+#define BM_READ 0x08            /* Transfer from disk to memory. */
+
+/* Bus master status register bits. */
+#define BM_ERROR 0x02           /* Transfer failed (write 1 to clear). */
+#define BM_INTR 0x04            /* Disk interrupted (write 1 to clear). */
+
+/* DMA commands. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Physical region descriptor: one physically contiguous piece
+   of a DMA buffer, which must not cross a 64 kB boundary. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address. */
+    uint16_t size;              /* Size in bytes, 0 meaning 64 kB. */
+    uint16_t flags;             /* PRD_EOT or 0. */
+  };
+#define PRD_EOT 0x8000          /* Last descriptor in the table. */
+
+/* PCI configuration space access ports. */
+#define PCI_CONFIG_ADDRESS 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+
+/* Maximum number of sectors transferred by one command.  The
+   Sector Count register is 8 bits wide, with 0 meaning 256. */
+#define MAX_SECTORS_PER_CMD 256
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +101,9 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    int multiple;               /* Sectors per interrupt for READ/WRITE
+                                   MULTIPLE, or 0 if not enabled. */
+    bool dma;                   /* Transfer by bus-master DMA? */
   };
 
 /* An ATA channel (aka controller).
@@ -66,11 +113,15 @@ struct channel
     char name[8];               /* Name, e.g. "ide0". */
     uint16_t reg_base;          /* Base I/O port. */
     uint8_t irq;                /* Interrupt in use. */
+    uint16_t bm_base;           /* Bus master I/O port, or 0 if none. */
+    struct prd *prdt;           /* PRD table, if BM_BASE is nonzero. */
 
     struct lock lock;           /* Must acquire to access the controller. */
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    struct block_dispatcher *dispatcher; /* Carries out requests for the
+                                            channel's disks. */
 
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
@@ -84,11 +135,16 @@ static struct block_operations ide_operations;
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
+static void set_multiple_mode (struct ata_disk *, int max);
+static uint16_t find_bus_master (void);
 
-static void select_sector (struct ata_disk *, block_sector_t);
-static void issue_pio_command (struct channel *, uint8_t command);
-static void input_sector (struct channel *, void *);
-static void output_sector (struct channel *, const void *);
+static void select_sector (struct ata_disk *, block_sector_t, size_t cnt);
+static void issue_command (struct channel *, uint8_t command);
+static void input_sectors (struct channel *, void *, size_t cnt);
+static void output_sectors (struct channel *, const void *, size_t cnt);
+static bool use_dma (const struct ata_disk *, const void *buffer);
+static bool dma_transfer (struct ata_disk *, block_sector_t, size_t cnt,
+                          const void *buffer, bool read);
 
 static void wait_until_idle (const struct ata_disk *);
 static bool wait_while_busy (const struct ata_disk *);
@@ -101,8 +157,14 @@ static void interrupt_handler (struct intr_frame *);
 void
 ide_init (void)
 {
+  uint16_t bm_base = find_bus_master ();
   size_t chan_no;
 
+  if (bm_base != 0)
+    printf ("ide: bus-master DMA at port 0x%"PRIx16"\n", bm_base);
+  else
+    printf ("ide: no bus-master controller, using PIO\n");
+
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
     {
       struct channel *c = &channels[chan_no];
@@ -123,8 +185,12 @@ ide_init (void)
         default:
           NOT_REACHED ();
         }
+      /* Each channel has 8 bytes of bus master registers. */
+      c->bm_base = bm_base != 0 ? bm_base + chan_no * 8 : 0;
+      c->prdt = bm_base != 0 ? palloc_get_page (PAL_ASSERT) : NULL;
       lock_init (&c->lock);
       c->expecting_interrupt = false;
+      c->dispatcher = NULL;
       sema_init (&c->completion_wait, 0);
 
       /* Initialize devices. */
@@ -136,6 +202,8 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->multiple = 0;
+          d->dma = false;
         }
 
       /* Register interrupt handler. */
@@ -272,14 +340,14 @@ identify_ata_device (struct ata_disk *d)
      indicating the device's response is ready, and read the data
      into our buffer. */
   select_device_wait (d);
-  issue_pio_command (c, CMD_IDENTIFY_DEVICE);
+  issue_command (c, CMD_IDENTIFY_DEVICE);
   sema_down (&c->completion_wait);
   if (!wait_while_busy (d))
     {
       d->is_ata = false;
       return;
     }
-  input_sector (c, id);
+  input_sectors (c, id, 1);
 
   /* Calculate capacity.
      Read model name and serial number. */
@@ -303,12 +371,45 @@ identify_ata_device (struct ata_disk *d)
       return;
     }
 
-  /* Register. */
+  /* Transfer as many sectors per interrupt as the disk allows,
+     as reported in the low byte of word 47.  Use DMA if both the
+     controller and the disk support it (word 49, bit 8). */
+  set_multiple_mode (d, (uint8_t) id[47 * 2]);
+  d->dma = c->bm_base != 0 && (id[49 * 2 + 1] & 0x01) != 0;
+
+  /* Register.  Requests for both disks on a channel go through
+     a single dispatcher, since only one can transfer at a time,
+     but the two channels work independently. */
   block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
                           &ide_operations, d);
+  if (c->dispatcher == NULL)
+    c->dispatcher = block_dispatcher_create (c->name);
+  block_set_dispatcher (block, c->dispatcher);
   partition_scan (block);
 }
 
+/* Sends a SET MULTIPLE MODE command to disk D asking for MAX
+   sectors per interrupt in READ MULTIPLE and WRITE MULTIPLE, and
+   records whether it took effect.  If MAX is 0, the disk does not
+   support those commands and nothing is sent. */
+static void
+set_multiple_mode (struct ata_disk *d, int max)
+{
+  struct channel *c = d->channel;
+
+  d->multiple = 0;
+  if (max == 0)
+    return;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), max);
+  issue_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if (!(inb (reg_alt_status (c)) & STA_ERR))
+    d->multiple = max;
+}
+
 /* Translates STRING, which consists of SIZE bytes in a funky
    format, into a null-terminated string in-place.  Drops
    trailing whitespace and null bytes.  Returns STRING.  */
@@ -337,63 +438,174 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
-/* Reads sector SEC_NO from disk D into BUFFER, which must have
-   room for BLOCK_SECTOR_SIZE bytes.
+/* Returns the number of sectors that disk D transfers per
+   interrupt in a command for CNT sectors, and stores in *COMMAND
+   the command to use: ONE_CMD, which interrupts once per sector,
+   or MULTI_CMD, which interrupts once per block of the disk's
+   multiple-mode size. */
+static size_t
+sectors_per_block (const struct ata_disk *d, size_t cnt, uint8_t one_cmd,
+                   uint8_t multi_cmd, uint8_t *command)
+{
+  if (d->multiple > 1 && cnt > 1)
+    {
+      *command = multi_cmd;
+      return d->multiple;
+    }
+  *command = one_cmd;
+  return 1;
+}
+
+/* Reads CNT sectors, at most MAX_SECTORS_PER_CMD, starting at
+   SEC_NO from disk D into BUFFER in PIO mode.  D's channel lock
+   must be held. */
+static void
+pio_read (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+          uint8_t *buffer)
+{
+  struct channel *c = d->channel;
+  uint8_t command;
+  size_t per_block = sectors_per_block (d, cnt, CMD_READ_SECTOR_RETRY,
+                                        CMD_READ_MULTIPLE, &command);
+  size_t i;
+
+  select_sector (d, sec_no, cnt);
+  issue_command (c, command);
+  for (i = 0; i < cnt; i += per_block)
+    {
+      size_t block_cnt = cnt - i < per_block ? cnt - i : per_block;
+      sema_down (&c->completion_wait);
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no + i);
+      input_sectors (c, buffer + i * BLOCK_SECTOR_SIZE, block_cnt);
+    }
+}
+
+/* Writes CNT sectors, at most MAX_SECTORS_PER_CMD, starting at
+   SEC_NO to disk D from BUFFER in PIO mode.  D's channel lock
+   must be held. */
+static void
+pio_write (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+           const uint8_t *buffer)
+{
+  struct channel *c = d->channel;
+  uint8_t command;
+  size_t per_block = sectors_per_block (d, cnt, CMD_WRITE_SECTOR_RETRY,
+                                        CMD_WRITE_MULTIPLE, &command);
+  size_t i;
+
+  select_sector (d, sec_no, cnt);
+  issue_command (c, command);
+  for (i = 0; i < cnt; i += per_block)
+    {
+      size_t block_cnt = cnt - i < per_block ? cnt - i : per_block;
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no + i);
+      output_sectors (c, buffer + i * BLOCK_SECTOR_SIZE, block_cnt);
+      sema_down (&c->completion_wait);
+    }
+}
+
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes, using
+   one command for every MAX_SECTORS_PER_CMD sectors.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_read (void *d_, block_sector_t sec_no, void *buffer)
+ide_read_multi (void *d_, block_sector_t sec_no, size_t cnt, void *buffer_)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  uint8_t *buffer = buffer_;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_SECTORS_PER_CMD ? cnt : MAX_SECTORS_PER_CMD;
+
+      if (!use_dma (d, buffer) || !dma_transfer (d, sec_no, n, buffer, true))
+        pio_read (d, sec_no, n, buffer);
+
+      sec_no += n;
+      buffer += n * BLOCK_SECTOR_SIZE;
+      cnt -= n;
+    }
   lock_release (&c->lock);
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes, using one
+   command for every MAX_SECTORS_PER_CMD sectors.  Returns after
+   the disk has acknowledged receiving the data.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+ide_write_multi (void *d_, block_sector_t sec_no, size_t cnt,
+                 const void *buffer_)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  const uint8_t *buffer = buffer_;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_SECTORS_PER_CMD ? cnt : MAX_SECTORS_PER_CMD;
+
+      if (!use_dma (d, buffer)
+          || !dma_transfer (d, sec_no, n, buffer, false))
+        pio_write (d, sec_no, n, buffer);
+
+      sec_no += n;
+      buffer += n * BLOCK_SECTOR_SIZE;
+      cnt -= n;
+    }
   lock_release (&c->lock);
 }
 
+/* Reads sector SEC_NO from disk D into BUFFER, which must have
+   room for BLOCK_SECTOR_SIZE bytes.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_read (void *d, block_sector_t sec_no, void *buffer)
+{
+  ide_read_multi (d, sec_no, 1, buffer);
+}
+
+/* Write sector SEC_NO to disk D from BUFFER, which must contain
+   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
+   acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_write (void *d, block_sector_t sec_no, const void *buffer)
+{
+  ide_write_multi (d, sec_no, 1, buffer);
+}
+
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multi,
+    ide_write_multi,
+    NULL
   };
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO to the disk's sector selection registers and CNT
+   to its sector count register.  (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt > 0 && cnt <= MAX_SECTORS_PER_CMD);
 
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt % MAX_SECTORS_PER_CMD);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -404,7 +616,7 @@ select_sector (struct ata_disk *d, block_sector_t sec_no)
 /* Writes COMMAND to channel C and prepares for receiving a
    completion interrupt. */
 static void
-issue_pio_command (struct channel *c, uint8_t command)
+issue_command (struct channel *c, uint8_t command)
 {
   /* Interrupts must be enabled or our semaphore will never be
      up'd by the completion handler. */
@@ -414,20 +626,165 @@ issue_pio_command (struct channel *c, uint8_t command)
   outb (reg_command (c), command);
 }
 
-/* Reads a sector from channel C's data register in PIO mode into
-   SECTOR, which must have room for BLOCK_SECTOR_SIZE bytes. */
+/* Returns true if a transfer between disk D and BUFFER can use
+   DMA.  The controller needs the physical address of BUFFER,
+   which must be word-aligned. */
+static bool
+use_dma (const struct ata_disk *d, const void *buffer)
+{
+  return (d->dma && is_kernel_vaddr (buffer)
+          && ((uintptr_t) buffer & 1) == 0);
+}
+
+/* Fills in the PRD table of channel C to describe the SIZE bytes
+   of BUFFER, one descriptor for each page that BUFFER touches,
+   and hands it to the controller. */
 static void
-input_sector (struct channel *c, void *sector)
+setup_prdt (struct channel *c, const void *buffer, size_t size)
 {
-  insw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  const uint8_t *p = buffer;
+  struct prd *prd = c->prdt;
+
+  ASSERT (size > 0);
+  ASSERT (size / PGSIZE + 2 <= PGSIZE / sizeof *prd);
+
+  while (size > 0)
+    {
+      size_t chunk = PGSIZE - pg_ofs (p);
+      if (chunk > size)
+        chunk = size;
+      prd->addr = vtop (p);
+      prd->size = chunk;
+      prd->flags = 0;
+      prd++;
+      p += chunk;
+      size -= chunk;
+    }
+  prd[-1].flags = PRD_EOT;
+
+  outl (reg_bm_prdt (c), vtop (c->prdt));
 }
 
-/* Writes SECTOR to channel C's data register in PIO mode.
-   SECTOR must contain BLOCK_SECTOR_SIZE bytes. */
+/* Transfers CNT sectors, at most MAX_SECTORS_PER_CMD, starting at
+   SEC_NO between disk D and BUFFER by bus-master DMA: from the
+   disk into BUFFER if READ is true, otherwise from BUFFER to the
+   disk.  D's channel lock must be held.  The CPU is free for
+   other threads until the completion interrupt.
+
+   Returns true if successful.  On failure, turns off DMA for D
+   and returns false, so that the caller can retry in PIO
+   mode. */
+static bool
+dma_transfer (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+              const void *buffer, bool read)
+{
+  struct channel *c = d->channel;
+  uint8_t direction = read ? BM_READ : 0;
+  uint8_t bm_status;
+  bool ok;
+
+  setup_prdt (c, buffer, cnt * BLOCK_SECTOR_SIZE);
+  outb (reg_bm_command (c), direction);
+  outb (reg_bm_status (c), inb (reg_bm_status (c)) | BM_ERROR | BM_INTR);
+
+  select_sector (d, sec_no, cnt);
+  issue_command (c, read ? CMD_READ_DMA : CMD_WRITE_DMA);
+  outb (reg_bm_command (c), direction | BM_START);
+  sema_down (&c->completion_wait);
+
+  /* Stop the engine, then check for errors. */
+  outb (reg_bm_command (c), direction);
+  bm_status = inb (reg_bm_status (c));
+  outb (reg_bm_status (c), bm_status | BM_ERROR | BM_INTR);
+  wait_while_busy (d);
+  ok = !(bm_status & BM_ERROR) && !(inb (reg_alt_status (c)) & STA_ERR);
+  if (!ok)
+    {
+      printf ("%s: DMA %s failed, sector=%"PRDSNu", switching to PIO\n",
+              d->name, read ? "read" : "write", sec_no);
+      d->dma = false;
+    }
+  return ok;
+}
+
+/* Reads CNT sectors from channel C's data register in PIO mode
+   into SECTORS, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
 static void
-output_sector (struct channel *c, const void *sector)
+input_sectors (struct channel *c, void *sectors, size_t cnt)
 {
-  outsw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  insw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
+}
+
+/* Writes CNT sectors to channel C's data register in PIO mode
+   from SECTORS, which must contain CNT * BLOCK_SECTOR_SIZE
+   bytes. */
+static void
+output_sectors (struct channel *c, const void *sectors, size_t cnt)
+{
+  outsw (reg_data (c), sectors, cnt * BLOCK_SECTOR_SIZE / 2);
+}
+
+/* Finding the bus master. */
+
+/* Reads the 32-bit register at offset REG in the PCI
+   configuration space of function FUNC of device DEV on BUS. */
+static uint32_t
+pci_read_config (int bus, int dev, int func, int reg)
+{
+  outl (PCI_CONFIG_ADDRESS,
+        0x80000000 | (bus << 16) | (dev << 11) | (func << 8) | (reg & 0xfc));
+  return inl (PCI_CONFIG_DATA);
+}
+
+/* Writes VALUE to the 32-bit register at offset REG in the PCI
+   configuration space of function FUNC of device DEV on BUS. */
+static void
+pci_write_config (int bus, int dev, int func, int reg, uint32_t value)
+{
+  outl (PCI_CONFIG_ADDRESS,
+        0x80000000 | (bus << 16) | (dev << 11) | (func << 8) | (reg & 0xfc));
+  outl (PCI_CONFIG_DATA, value);
+}
+
+/* Looks on PCI bus 0 for an IDE controller that can act as a bus
+   master and drives both channels at their legacy ports, which
+   are the only ones we know how to use.  If there is one, enables
+   bus mastering on it and returns the base I/O port of its bus
+   master registers.  Otherwise, returns 0. */
+static uint16_t
+find_bus_master (void)
+{
+  int dev, func;
+
+  for (dev = 0; dev < 32; dev++)
+    for (func = 0; func < 8; func++)
+      {
+        uint32_t id = pci_read_config (0, dev, func, 0x00);
+        uint32_t class = pci_read_config (0, dev, func, 0x08);
+        uint32_t command, bar4;
+
+        /* Class 1, subclass 1 is IDE.  In the programming
+           interface byte, bit 7 means bus master capable and
+           bits 0 and 2 mean native rather than legacy mode. */
+        if ((id & 0xffff) == 0xffff
+            || (class >> 16) != 0x0101
+            || (class & 0x8000) == 0
+            || (class & 0x0500) != 0)
+          continue;
+
+        /* BAR 4 holds the bus master registers, in I/O space. */
+        bar4 = pci_read_config (0, dev, func, 0x20);
+        if ((bar4 & 1) == 0 || (bar4 & 0xfffc) == 0)
+          continue;
+
+        /* Enable I/O space access and bus mastering.  The upper
+           half of the register is status, which we leave alone. */
+        command = pci_read_config (0, dev, func, 0x04) & 0xffff;
+        pci_write_config (0, dev, func, 0x04, command | 0x05);
+        return bar4 & 0xfffc;
+      }
+  return 0;
 }
 
 /* Low-level ATA primitives. */
@@ -0,0 +1,160 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A block device whose sectors are kept in memory.  Its contents
+   are lost at shutdown, so it suits scratch and swap data and
+   file system benchmarks that should not depend on the speed of
+   the emulated disks.
+
+   The pages come from the user pool, which is usually the larger
+   one.  They need not be contiguous. */
+
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A RAM disk. */
+struct ramdisk
+  {
+    uint8_t **pages;            /* Pages holding the sectors. */
+    size_t page_cnt;            /* Number of pages. */
+  };
+
+/* Requested size in kB of the RAM disk for each role, or 0 for
+   none. */
+static size_t ramdisk_kb[BLOCK_ROLE_CNT];
+
+static struct block_operations ramdisk_operations;
+
+/* Sets the role and size of a RAM disk to create from VALUE,
+   given as ROLE:KB, e.g. "scratch:1024".  Panics if VALUE is
+   malformed. */
+void
+ramdisk_configure (const char *value)
+{
+  const char *colon = value != NULL ? strchr (value, ':') : NULL;
+  enum block_type role;
+
+  if (colon != NULL)
+    for (role = 0; role < BLOCK_ROLE_CNT; role++)
+      {
+        const char *name = block_type_name (role);
+        if (role != BLOCK_KERNEL
+            && strlen (name) == (size_t) (colon - value)
+            && !memcmp (name, value, colon - value))
+          {
+            int kb = atoi (colon + 1);
+            if (kb <= 0)
+              break;
+            ramdisk_kb[role] = kb;
+            return;
+          }
+      }
+  PANIC ("bad RAM disk `%s' (use ROLE:KB, "
+         "where ROLE is filesys, scratch or swap)", value);
+}
+
+/* Creates the RAM disks requested with ramdisk_configure().
+   Each is registered with the type of its role.  Call this
+   before other block devices are probed, so that the RAM disk
+   comes first and is chosen for its role by default. */
+void
+ramdisk_init (void)
+{
+  enum block_type role;
+  int disk_no = 0;
+
+  for (role = 0; role < BLOCK_ROLE_CNT; role++)
+    if (ramdisk_kb[role] > 0)
+      {
+        struct ramdisk *rd = malloc (sizeof *rd);
+        char name[16];
+        size_t i;
+
+        if (rd == NULL)
+          PANIC ("Failed to allocate memory for RAM disk descriptor");
+        rd->page_cnt = DIV_ROUND_UP (ramdisk_kb[role] * 1024, PGSIZE);
+        rd->pages = malloc (rd->page_cnt * sizeof *rd->pages);
+        if (rd->pages == NULL)
+          PANIC ("Failed to allocate memory for RAM disk page table");
+        for (i = 0; i < rd->page_cnt; i++)
+          {
+            rd->pages[i] = palloc_get_page (PAL_USER | PAL_ZERO);
+            if (rd->pages[i] == NULL)
+              PANIC ("Out of memory for %zu kB RAM disk", ramdisk_kb[role]);
+          }
+
+        snprintf (name, sizeof name, "rd%d", disk_no++);
+        block_register (name, role, "RAM disk",
+                        rd->page_cnt * SECTORS_PER_PAGE,
+                        &ramdisk_operations, rd);
+      }
+}
+
+/* Returns the address of sector SECTOR of RD. */
+static uint8_t *
+sector_addr (struct ramdisk *rd, block_sector_t sector)
+{
+  return (rd->pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Reads CNT sectors starting at SECTOR from RAM disk RD_ into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
+static void
+ramdisk_read_multi (void *rd_, block_sector_t sector, size_t cnt,
+                    void *buffer_)
+{
+  struct ramdisk *rd = rd_;
+  uint8_t *buffer = buffer_;
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    memcpy (buffer + i * BLOCK_SECTOR_SIZE, sector_addr (rd, sector + i),
+            BLOCK_SECTOR_SIZE);
+}
+
+/* Writes CNT sectors starting at SECTOR to RAM disk RD_ from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_write_multi (void *rd_, block_sector_t sector, size_t cnt,
+                     const void *buffer_)
+{
+  struct ramdisk *rd = rd_;
+  const uint8_t *buffer = buffer_;
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    memcpy (sector_addr (rd, sector + i), buffer + i * BLOCK_SECTOR_SIZE,
+            BLOCK_SECTOR_SIZE);
+}
+
+/* Reads sector SECTOR from RAM disk RD into BUFFER. */
+static void
+ramdisk_read (void *rd, block_sector_t sector, void *buffer)
+{
+  ramdisk_read_multi (rd, sector, 1, buffer);
+}
+
+/* Writes sector SECTOR to RAM disk RD from BUFFER. */
+static void
+ramdisk_write (void *rd, block_sector_t sector, const void *buffer)
+{
+  ramdisk_write_multi (rd, sector, 1, buffer);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_read_multi,
+    ramdisk_write_multi,
+    NULL
+  };
@@ -0,0 +1,7 @@
+#ifndef DEVICES_RAMDISK_H
+#define DEVICES_RAMDISK_H
+
+void ramdisk_configure (const char *);
+void ramdisk_init (void);
+
+#endif /* devices/ramdisk.h */
@@ -0,0 +1,188 @@
+#include "devices/stripe.h"
+#include <debug.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+
+/* A striped (RAID-0) block device.  Sectors are dealt out to the
+   member devices in stripe units of STRIPE_SECTORS consecutive
+   sectors, round-robin, so that a large transfer keeps every
+   member busy at once.  There is no redundancy: losing any member
+   loses the device.
+
+   Members are reached through the block layer's asynchronous
+   interface, so that members on different IDE channels transfer
+   at the same time, and each member's own queue merges the units
+   that end up adjacent on it. */
+
+/* Maximum number of member devices. */
+#define STRIPE_MAX_MEMBERS 8
+
+/* Default stripe unit, in sectors. */
+#define STRIPE_DEFAULT_SECTORS 8
+
+/* Maximum number of member requests in flight for one transfer. */
+#define STRIPE_BATCH 8
+
+/* A striped device. */
+struct stripe
+  {
+    struct block *members[STRIPE_MAX_MEMBERS]; /* Member devices. */
+    size_t member_cnt;                  /* Number of members. */
+    size_t unit;                        /* Sectors per stripe unit. */
+  };
+
+static struct block_operations stripe_operations;
+
+/* Creates and registers a striped device named "md0" as the file
+   system device from SPEC, which has the form
+   DEV,DEV[,DEV...][:UNIT], where each DEV names a block device
+   and UNIT is the stripe unit in sectors.  SPEC is modified.
+   Returns the new device.  Panics if SPEC is malformed. */
+struct block *
+stripe_create (char *spec)
+{
+  struct stripe *s = malloc (sizeof *s);
+  block_sector_t member_size = 0;
+  char *units, *name, *save_ptr;
+  char extra_info[64];
+  size_t i;
+
+  if (s == NULL)
+    PANIC ("Failed to allocate memory for striped device descriptor");
+
+  units = strchr (spec, ':');
+  if (units != NULL)
+    *units++ = '\0';
+  if (units != NULL)
+    {
+      int unit = atoi (units);
+      if (unit <= 0)
+        PANIC ("bad stripe unit `%s'", units);
+      s->unit = unit;
+    }
+  else
+    s->unit = STRIPE_DEFAULT_SECTORS;
+
+  s->member_cnt = 0;
+  for (name = strtok_r (spec, ",", &save_ptr); name != NULL;
+       name = strtok_r (NULL, ",", &save_ptr))
+    {
+      struct block *member = block_get_by_name (name);
+      if (member == NULL)
+        PANIC ("No such block device \"%s\"", name);
+      if (s->member_cnt >= STRIPE_MAX_MEMBERS)
+        PANIC ("Striped device has more than %d members",
+               STRIPE_MAX_MEMBERS);
+      s->members[s->member_cnt++] = member;
+    }
+  if (s->member_cnt < 2)
+    PANIC ("Striped device needs at least 2 members");
+
+  /* Use the same whole number of units from every member. */
+  for (i = 0; i < s->member_cnt; i++)
+    if (i == 0 || block_size (s->members[i]) < member_size)
+      member_size = block_size (s->members[i]);
+  member_size -= member_size % s->unit;
+  if (member_size == 0)
+    PANIC ("Stripe unit of %zu sectors is larger than a member device",
+           s->unit);
+
+  snprintf (extra_info, sizeof extra_info,
+            "striped over %zu devices, %zu-sector units",
+            s->member_cnt, s->unit);
+  return block_register ("md0", BLOCK_FILESYS, extra_info,
+                         member_size * s->member_cnt,
+                         &stripe_operations, s);
+}
+
+/* Transfers CNT sectors starting at SECTOR between striped device
+   S and BUFFER: from the device into BUFFER if WRITE is false,
+   otherwise the other way. */
+static void
+stripe_transfer (struct stripe *s, block_sector_t sector, size_t cnt,
+                 uint8_t *buffer, bool write)
+{
+  while (cnt > 0)
+    {
+      struct block_request requests[STRIPE_BATCH];
+      size_t req_cnt, i;
+
+      /* Start a request on the right member for each stripe unit
+         touched, up to STRIPE_BATCH of them... */
+      for (req_cnt = 0; req_cnt < STRIPE_BATCH && cnt > 0; req_cnt++)
+        {
+          block_sector_t unit_no = sector / s->unit;
+          size_t ofs = sector % s->unit;
+          size_t chunk = s->unit - ofs < cnt ? s->unit - ofs : cnt;
+          struct block *member = s->members[unit_no % s->member_cnt];
+          block_sector_t member_sector
+            = unit_no / s->member_cnt * s->unit + ofs;
+
+          block_request_init (&requests[req_cnt], member_sector, chunk,
+                              buffer, write, NULL, NULL);
+          block_submit (member, &requests[req_cnt]);
+
+          sector += chunk;
+          buffer += chunk * BLOCK_SECTOR_SIZE;
+          cnt -= chunk;
+        }
+
+      /* ...then wait for all of them. */
+      for (i = 0; i < req_cnt; i++)
+        block_wait (&requests[i]);
+    }
+}
+
+/* Reads CNT sectors starting at SECTOR from striped device S into
+   BUFFER. */
+static void
+stripe_read_multi (void *s, block_sector_t sector, size_t cnt, void *buffer)
+{
+  stripe_transfer (s, sector, cnt, buffer, false);
+}
+
+/* Writes CNT sectors starting at SECTOR to striped device S from
+   BUFFER. */
+static void
+stripe_write_multi (void *s, block_sector_t sector, size_t cnt,
+                    const void *buffer)
+{
+  stripe_transfer (s, sector, cnt, (void *) buffer, true);
+}
+
+/* Reads sector SECTOR from striped device S into BUFFER. */
+static void
+stripe_read (void *s, block_sector_t sector, void *buffer)
+{
+  stripe_transfer (s, sector, 1, buffer, false);
+}
+
+/* Writes sector SECTOR to striped device S from BUFFER. */
+static void
+stripe_write (void *s, block_sector_t sector, const void *buffer)
+{
+  stripe_transfer (s, sector, 1, (void *) buffer, true);
+}
+
+/* Prints the statistics of each member of striped device S_. */
+static void
+stripe_print_stats (void *s_)
+{
+  struct stripe *s = s_;
+  size_t i;
+
+  for (i = 0; i < s->member_cnt; i++)
+    block_print_device_stats (s->members[i], "  ");
+}
+
+static struct block_operations stripe_operations =
+  {
+    stripe_read,
+    stripe_write,
+    stripe_read_multi,
+    stripe_write_multi,
+    stripe_print_stats
+  };
@@ -0,0 +1,8 @@
+#ifndef DEVICES_STRIPE_H
+#define DEVICES_STRIPE_H
+
+struct block;
+
+struct block *stripe_create (char *spec);
+
+#endif /* devices/stripe.h */
@@ -24,7 +24,21 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* A thread blocked in timer_sleep(). */
+struct sleeper
+  {
+    int64_t wakeup;                     /* Tick at which to wake up. */
+    struct semaphore sema;              /* Upped to wake the thread. */
+    struct list_elem elem;              /* Element in SLEEPERS. */
+  };
+
+/* Sleeping threads, in order of increasing wakeup tick.  The
+   timer interrupt handler wakes them, so the list is protected
+   by disabling interrupts. */
+static struct list sleepers;
+
 static intr_handler_func timer_interrupt;
+static list_less_func sleeper_less;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
@@ -36,6 +50,7 @@ void
 timer_init (void)
 {
   pit_configure_channel (0, 2, TIMER_FREQ);
+  list_init (&sleepers);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -85,15 +100,24 @@ timer_elapsed (int64_t then)
 }
 
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.  The thread blocks until the timer interrupt
+   wakes it rather than spinning. */
 void
 timer_sleep (int64_t ticks)
 {
-  int64_t start = timer_ticks ();
+  struct sleeper s;
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks)
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  s.wakeup = timer_ticks () + ticks;
+  sema_init (&s.sema, 0);
+  old_level = intr_disable ();
+  list_insert_ordered (&sleepers, &s.elem, sleeper_less, NULL);
+  intr_set_level (old_level);
+  sema_down (&s.sema);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -172,6 +196,27 @@ timer_interrupt (struct intr_frame *args UNUSED)
 {
   ticks++;
   thread_tick ();
+
+  while (!list_empty (&sleepers))
+    {
+      struct sleeper *s = list_entry (list_front (&sleepers),
+                                      struct sleeper, elem);
+      if (s->wakeup > ticks)
+        break;
+      list_pop_front (&sleepers);
+      sema_up (&s->sema);
+    }
+}
+
+/* Orders sleepers by wakeup tick. */
+static bool
+sleeper_less (const struct list_elem *a_, const struct list_elem *b_,
+              void *aux UNUSED)
+{
+  const struct sleeper *a = list_entry (a_, struct sleeper, elem);
+  const struct sleeper *b = list_entry (b_, struct sleeper, elem);
+
+  return a->wakeup < b->wakeup;
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
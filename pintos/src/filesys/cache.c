@@ -0,0 +1,714 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "filesys/journal.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* A sector held in the buffer cache. */
+struct cache_entry
+  {
+    block_sector_t sector;              /* Sector held, if VALID. */
+    bool valid;                         /* Does this entry hold a sector? */
+    bool dirty;                         /* Modified since last written? */
+    int64_t dirty_since;                /* Timer tick when DIRTY was set. */
+    bool accessed;                      /* Used since the clock hand passed? */
+    bool prefetched;                    /* Read ahead and not yet used? */
+    bool pinned;                        /* In an uncommitted journal
+                                           transaction? */
+    struct lock lock;                   /* Protects the entry and DATA. */
+    uint8_t *data;                      /* BLOCK_SECTOR_SIZE bytes. */
+  };
+
+/* The buffer cache.  CACHE_LOCK protects the mapping from sectors
+   to entries (each entry's SECTOR and VALID) and the clock hand;
+   an entry's own lock protects everything else about it.  The
+   entry lock is only ever try-acquired with CACHE_LOCK held, so
+   the two cannot deadlock. */
+static struct cache_entry cache[CACHE_SIZE];
+static struct lock cache_lock;
+static size_t clock_hand;
+
+/* Sectors queued for the read-ahead thread, in a ring buffer
+   protected by READ_AHEAD_LOCK. */
+#define READ_AHEAD_QUEUE_SIZE 64
+static block_sector_t read_ahead_queue[READ_AHEAD_QUEUE_SIZE];
+static size_t read_ahead_head;
+static size_t read_ahead_cnt;
+static struct lock read_ahead_lock;
+static struct condition read_ahead_cond;
+
+/* Write-behind.  DIRTY_CNT counts dirty entries; it,
+   EVICT_BLOCKED, and the condition are protected by
+   WRITE_BEHIND_LOCK, which may be acquired with CACHE_LOCK or an
+   entry lock held but not the other way around.  The write-behind thread writes back dirty
+   sectors once they are FLUSH_AGE milliseconds old, or all of
+   them as soon as more than DIRTY_RATIO percent of the cache is
+   dirty or a thread finds nothing to evict. */
+static int flush_age = 1000;
+static int dirty_ratio = 50;
+static size_t dirty_cnt;
+static bool evict_blocked;
+static struct lock write_behind_lock;
+static struct condition write_behind_cond;
+
+/* Statistics. */
+static unsigned long long hit_cnt;      /* Demand accesses found cached. */
+static unsigned long long miss_cnt;     /* Demand accesses read from disk. */
+static unsigned long long prefetch_cnt; /* Sectors brought in by read-ahead. */
+static unsigned long long ra_hit_cnt;   /* Read-ahead sectors later used. */
+static unsigned long long ra_miss_cnt;  /* Read-ahead sectors evicted unused. */
+
+static struct cache_entry *cache_get (block_sector_t, bool load, bool *hit);
+static struct cache_entry *cache_find (block_sector_t);
+static struct cache_entry *cache_evict (void);
+static struct cache_entry *cache_get_demand (block_sector_t, bool load);
+static struct cache_entry *cache_claim (block_sector_t);
+static void load_run (struct cache_entry *run[], size_t run_cnt,
+                      uint8_t *bounce);
+static void mark_dirty (struct cache_entry *);
+static void write_back (struct cache_entry *);
+static void write_back_runs (bool all, int64_t age_ticks);
+static bool too_many_dirty (void);
+static thread_func read_ahead_daemon NO_RETURN;
+static thread_func write_behind_daemon NO_RETURN;
+
+/* Sets the age in milliseconds at which dirty sectors are
+   written back to AGE and the percentage of the cache that may be
+   dirty before all of it is written back to RATIO.  Nonpositive
+   values leave the corresponding setting unchanged.  Must be
+   called before cache_init(). */
+void
+cache_configure (int age, int ratio)
+{
+  if (age > 0)
+    flush_age = age;
+  if (ratio > 0)
+    dirty_ratio = ratio < 100 ? ratio : 100;
+}
+
+/* Initializes the buffer cache. */
+void
+cache_init (void)
+{
+  size_t page_cnt = DIV_ROUND_UP (CACHE_SIZE * BLOCK_SECTOR_SIZE, PGSIZE);
+  uint8_t *data = palloc_get_multiple (PAL_ASSERT, page_cnt);
+  size_t i;
+
+  lock_init (&cache_lock);
+  clock_hand = 0;
+  for (i = 0; i < CACHE_SIZE; i++)
+    {
+      struct cache_entry *e = &cache[i];
+      e->valid = false;
+      e->dirty = false;
+      e->accessed = false;
+      e->prefetched = false;
+      e->pinned = false;
+      lock_init (&e->lock);
+      e->data = data + i * BLOCK_SECTOR_SIZE;
+    }
+
+  read_ahead_head = read_ahead_cnt = 0;
+  lock_init (&read_ahead_lock);
+  cond_init (&read_ahead_cond);
+  thread_create ("read-ahead", PRI_DEFAULT, read_ahead_daemon, NULL);
+
+  dirty_cnt = 0;
+  lock_init (&write_behind_lock);
+  cond_init (&write_behind_cond);
+  thread_create ("write-behind", PRI_DEFAULT, write_behind_daemon, NULL);
+}
+
+/* Reads all of SECTOR into BUFFER, which must have room for
+   BLOCK_SECTOR_SIZE bytes. */
+void
+cache_read (block_sector_t sector, void *buffer)
+{
+  cache_read_at (sector, buffer, BLOCK_SECTOR_SIZE, 0);
+}
+
+/* Writes all of SECTOR from BUFFER, which must contain
+   BLOCK_SECTOR_SIZE bytes.  The data reaches the disk when the
+   entry is evicted or the cache is flushed. */
+void
+cache_write (block_sector_t sector, const void *buffer)
+{
+  cache_write_at (sector, buffer, BLOCK_SECTOR_SIZE, 0);
+}
+
+/* Reads SIZE bytes starting at byte OFFSET within SECTOR into
+   BUFFER. */
+void
+cache_read_at (block_sector_t sector, void *buffer, off_t size, off_t offset)
+{
+  struct cache_entry *e;
+
+  ASSERT (offset >= 0 && size >= 0 && offset + size <= BLOCK_SECTOR_SIZE);
+
+  e = cache_get_demand (sector, true);
+  memcpy (buffer, e->data + offset, size);
+  lock_release (&e->lock);
+}
+
+/* Writes SIZE bytes from BUFFER starting at byte OFFSET within
+   SECTOR.  A write that covers the whole sector does not need to
+   read the old contents from disk.  Inside a journal update, the
+   sector joins the running transaction and is not written back
+   until it commits. */
+void
+cache_write_at (block_sector_t sector, const void *buffer, off_t size,
+                off_t offset)
+{
+  struct cache_entry *e;
+
+  ASSERT (offset >= 0 && size >= 0 && offset + size <= BLOCK_SECTOR_SIZE);
+
+  e = cache_get_demand (sector, size < BLOCK_SECTOR_SIZE);
+  memcpy (e->data + offset, buffer, size);
+  mark_dirty (e);
+  if (journal_add (sector))
+    e->pinned = true;
+  lock_release (&e->lock);
+}
+
+/* Writes all of SECTOR from BUFFER and then straight to disk,
+   without joining the running journal transaction.  Meant for a
+   sector just allocated, which no committed metadata refers to
+   yet, so that it is safe to write home at once, and which must
+   be on disk before metadata that refers to it commits. */
+void
+cache_write_through (block_sector_t sector, const void *buffer)
+{
+  struct cache_entry *e = cache_get_demand (sector, false);
+
+  memcpy (e->data, buffer, BLOCK_SECTOR_SIZE);
+  mark_dirty (e);
+  if (!e->pinned)
+    write_back (e);
+  lock_release (&e->lock);
+}
+
+/* Copies all of sector SRC into sector DST inside the cache.
+   SRC is read from disk if necessary; DST is overwritten whole,
+   so it is not.  The two entries are locked in sector order, so
+   that concurrent copies between the same sectors cannot
+   deadlock. */
+void
+cache_copy (block_sector_t dst, block_sector_t src)
+{
+  struct cache_entry *d, *s;
+
+  ASSERT (dst != src);
+
+  if (src < dst)
+    {
+      s = cache_get_demand (src, true);
+      d = cache_get_demand (dst, false);
+    }
+  else
+    {
+      d = cache_get_demand (dst, false);
+      s = cache_get_demand (src, true);
+    }
+  memcpy (d->data, s->data, BLOCK_SECTOR_SIZE);
+  mark_dirty (d);
+  if (journal_add (dst))
+    d->pinned = true;
+  lock_release (&s->lock);
+  lock_release (&d->lock);
+}
+
+/* Queues SECTOR to be read into the cache in the background.
+   Returns false if the read-ahead queue is full. */
+bool
+cache_read_ahead (block_sector_t sector)
+{
+  bool success = false;
+
+  lock_acquire (&read_ahead_lock);
+  if (read_ahead_cnt < READ_AHEAD_QUEUE_SIZE)
+    {
+      size_t tail = (read_ahead_head + read_ahead_cnt) % READ_AHEAD_QUEUE_SIZE;
+      read_ahead_queue[tail] = sector;
+      read_ahead_cnt++;
+      cond_signal (&read_ahead_cond, &read_ahead_lock);
+      success = true;
+    }
+  lock_release (&read_ahead_lock);
+  return success;
+}
+
+/* Prints buffer cache statistics. */
+void
+cache_print_stats (void)
+{
+  printf ("Cache: %llu hits, %llu misses\n", hit_cnt, miss_cnt);
+  printf ("Read-ahead: %llu sectors prefetched, %llu hits, %llu misses\n",
+          prefetch_cnt, ra_hit_cnt, ra_miss_cnt);
+}
+
+/* Writes every dirty sector in the cache back to disk, except
+   those in an uncommitted journal transaction. */
+void
+cache_flush (void)
+{
+  write_back_runs (true, 0);
+}
+
+/* Allows SECTOR, whose journal transaction has committed, to be
+   written back. */
+void
+cache_unpin (block_sector_t sector)
+{
+  struct cache_entry *e;
+
+  lock_acquire (&cache_lock);
+  e = cache_find (sector);
+  lock_release (&cache_lock);
+  if (e != NULL)
+    {
+      lock_acquire (&e->lock);
+      if (e->valid && e->sector == sector)
+        e->pinned = false;
+      lock_release (&e->lock);
+    }
+}
+
+/* Marks entry E, whose lock must be held, as modified.  Wakes
+   the write-behind thread if E is the first dirty entry or if it
+   pushes the cache over the dirty ratio. */
+static void
+mark_dirty (struct cache_entry *e)
+{
+  ASSERT (lock_held_by_current_thread (&e->lock));
+
+  if (e->dirty)
+    return;
+  e->dirty = true;
+  e->dirty_since = timer_ticks ();
+
+  lock_acquire (&write_behind_lock);
+  dirty_cnt++;
+  if (dirty_cnt == 1 || too_many_dirty ())
+    cond_signal (&write_behind_cond, &write_behind_lock);
+  lock_release (&write_behind_lock);
+}
+
+/* Writes dirty entry E, whose lock must be held, back to disk. */
+static void
+write_back (struct cache_entry *e)
+{
+  ASSERT (lock_held_by_current_thread (&e->lock));
+  ASSERT (e->valid && e->dirty);
+
+  block_write (fs_device, e->sector, e->data);
+  e->dirty = false;
+
+  lock_acquire (&write_behind_lock);
+  dirty_cnt--;
+  lock_release (&write_behind_lock);
+}
+
+/* Maximum number of sectors written back by one multi-sector
+   write, which go through a page-sized bounce buffer. */
+#define WRITE_BACK_RUN (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Returns true if entry E, whose lock must be held, should be
+   written back by write_back_runs (ALL, AGE_TICKS). */
+static bool
+wants_write_back (const struct cache_entry *e, bool all, int64_t age_ticks)
+{
+  return (e->valid && e->dirty && !e->pinned
+          && (all || timer_elapsed (e->dirty_since) >= age_ticks));
+}
+
+/* Writes back every dirty entry not in the running journal
+   transaction, or if ALL is false only those dirty for at least
+   AGE_TICKS timer ticks.  Entries for consecutive sectors are
+   written together with block_write_multi().
+
+   The entries are visited in sector order.  Once a run's first
+   entry is locked, later entries only join it if their locks are
+   free, since waiting for one while holding others could
+   deadlock with a journal commit. */
+static void
+write_back_runs (bool all, int64_t age_ticks)
+{
+  struct cache_entry *order[CACHE_SIZE];
+  uint8_t *bounce = palloc_get_page (0);
+  size_t order_cnt = 0;
+  size_t i, j;
+
+  /* Sort the candidates by sector.  The entries are not locked
+     yet, so this only picks the order; each is checked again
+     once locked. */
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (cache[i].valid && cache[i].dirty)
+      {
+        for (j = order_cnt; j > 0 && order[j - 1]->sector > cache[i].sector;
+             j--)
+          order[j] = order[j - 1];
+        order[j] = &cache[i];
+        order_cnt++;
+      }
+
+  for (i = 0; i < order_cnt; i = j)
+    {
+      struct cache_entry *run[WRITE_BACK_RUN];
+      size_t run_cnt = 0;
+      size_t k;
+
+      j = i + 1;
+      lock_acquire (&order[i]->lock);
+      if (!wants_write_back (order[i], all, age_ticks))
+        {
+          lock_release (&order[i]->lock);
+          continue;
+        }
+      run[run_cnt++] = order[i];
+
+      while (bounce != NULL && run_cnt < WRITE_BACK_RUN && j < order_cnt
+             && lock_try_acquire (&order[j]->lock))
+        {
+          if (!wants_write_back (order[j], all, age_ticks)
+              || order[j]->sector != run[run_cnt - 1]->sector + 1)
+            {
+              lock_release (&order[j]->lock);
+              break;
+            }
+          run[run_cnt++] = order[j++];
+        }
+
+      if (run_cnt == 1)
+        write_back (run[0]);
+      else
+        {
+          for (k = 0; k < run_cnt; k++)
+            memcpy (bounce + k * BLOCK_SECTOR_SIZE, run[k]->data,
+                    BLOCK_SECTOR_SIZE);
+          block_write_multi (fs_device, run[0]->sector, run_cnt, bounce);
+          for (k = 0; k < run_cnt; k++)
+            run[k]->dirty = false;
+
+          lock_acquire (&write_behind_lock);
+          dirty_cnt -= run_cnt;
+          lock_release (&write_behind_lock);
+        }
+      for (k = 0; k < run_cnt; k++)
+        lock_release (&run[k]->lock);
+    }
+  palloc_free_page (bounce);
+}
+
+/* Returns true if more than DIRTY_RATIO percent of the cache is
+   dirty. */
+static bool
+too_many_dirty (void)
+{
+  return dirty_cnt * 100 > (size_t) dirty_ratio * CACHE_SIZE;
+}
+
+/* Number of timer ticks the write-behind thread sleeps at a time
+   while waiting for dirty sectors to age, between checks of the
+   dirty ratio. */
+#define WRITE_BEHIND_STEP (TIMER_FREQ / 50 > 0 ? TIMER_FREQ / 50 : 1)
+
+/* Write-behind thread.  Sleeps until some sector is dirty, waits
+   for it to age, then writes back every sector that has been
+   dirty for at least FLUSH_AGE milliseconds.  If the cache goes
+   over the dirty ratio or eviction fails in the meantime, stops
+   waiting and writes back every dirty sector. */
+static void
+write_behind_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      int64_t age_ticks = (int64_t) flush_age * TIMER_FREQ / 1000;
+      int64_t start;
+      bool flush_all;
+
+      lock_acquire (&write_behind_lock);
+      while (dirty_cnt == 0 && !evict_blocked)
+        cond_wait (&write_behind_cond, &write_behind_lock);
+      lock_release (&write_behind_lock);
+
+      start = timer_ticks ();
+      while (!too_many_dirty () && !evict_blocked)
+        {
+          int64_t left = age_ticks - timer_elapsed (start);
+          if (left <= 0)
+            break;
+          timer_sleep (left < WRITE_BEHIND_STEP ? left : WRITE_BEHIND_STEP);
+        }
+      lock_acquire (&write_behind_lock);
+      flush_all = too_many_dirty () || evict_blocked;
+      evict_blocked = false;
+      lock_release (&write_behind_lock);
+
+      /* Sectors in the running journal transaction cannot be
+         written back until it commits. */
+      journal_commit ();
+      write_back_runs (flush_all, age_ticks);
+    }
+}
+
+/* Maximum number of sectors read ahead by one multi-sector
+   read, which goes through a page-sized bounce buffer. */
+#define READ_AHEAD_RUN (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Read-ahead thread.  Loads queued sectors into the cache so
+   that sequential readers find them there.  Consecutive queued
+   sectors that are not yet cached are read together with
+   block_read_multi(). */
+static void
+read_ahead_daemon (void *aux UNUSED)
+{
+  uint8_t *bounce = palloc_get_page (0);
+
+  for (;;)
+    {
+      block_sector_t sectors[READ_AHEAD_RUN];
+      struct cache_entry *run[READ_AHEAD_RUN];
+      size_t sector_cnt = 0;
+      size_t run_cnt = 0;
+      size_t i;
+
+      /* Take the first queued sector and any that follow it on
+         disk. */
+      lock_acquire (&read_ahead_lock);
+      while (read_ahead_cnt == 0)
+        cond_wait (&read_ahead_cond, &read_ahead_lock);
+      do
+        {
+          sectors[sector_cnt++] = read_ahead_queue[read_ahead_head];
+          read_ahead_head = (read_ahead_head + 1) % READ_AHEAD_QUEUE_SIZE;
+          read_ahead_cnt--;
+        }
+      while (bounce != NULL && sector_cnt < READ_AHEAD_RUN
+             && read_ahead_cnt > 0
+             && (read_ahead_queue[read_ahead_head]
+                 == sectors[sector_cnt - 1] + 1));
+      lock_release (&read_ahead_lock);
+
+      /* A sector that is already cached splits the run. */
+      for (i = 0; i < sector_cnt; i++)
+        {
+          struct cache_entry *e = cache_claim (sectors[i]);
+          if (e != NULL)
+            run[run_cnt++] = e;
+          else
+            {
+              load_run (run, run_cnt, bounce);
+              run_cnt = 0;
+            }
+        }
+      load_run (run, run_cnt, bounce);
+    }
+}
+
+/* Reads the RUN_CNT consecutive sectors claimed in RUN from disk,
+   through BOUNCE if there is more than one, and releases their
+   entries. */
+static void
+load_run (struct cache_entry *run[], size_t run_cnt, uint8_t *bounce)
+{
+  size_t k;
+
+  if (run_cnt == 0)
+    return;
+  if (run_cnt == 1)
+    block_read (fs_device, run[0]->sector, run[0]->data);
+  else
+    {
+      block_read_multi (fs_device, run[0]->sector, run_cnt, bounce);
+      for (k = 0; k < run_cnt; k++)
+        memcpy (run[k]->data, bounce + k * BLOCK_SECTOR_SIZE,
+                BLOCK_SECTOR_SIZE);
+    }
+  prefetch_cnt += run_cnt;
+  for (k = 0; k < run_cnt; k++)
+    {
+      run[k]->prefetched = true;
+      lock_release (&run[k]->lock);
+    }
+}
+
+/* Like cache_get(), for an access on behalf of a reader or
+   writer rather than read-ahead.  Updates statistics. */
+static struct cache_entry *
+cache_get_demand (block_sector_t sector, bool load)
+{
+  bool hit;
+  struct cache_entry *e = cache_get (sector, load, &hit);
+
+  if (hit)
+    hit_cnt++;
+  else
+    miss_cnt++;
+  if (e->prefetched)
+    {
+      e->prefetched = false;
+      ra_hit_cnt++;
+    }
+  return e;
+}
+
+/* Returns the entry that holds SECTOR, with its lock held, and
+   sets *HIT to whether SECTOR was already cached.  If it was
+   not, an entry is evicted to make room for it and, if LOAD is
+   true, SECTOR is read into it from disk.  A caller that is
+   about to overwrite the whole sector passes false for LOAD. */
+static struct cache_entry *
+cache_get (block_sector_t sector, bool load, bool *hit)
+{
+  for (;;)
+    {
+      struct cache_entry *e;
+
+      lock_acquire (&cache_lock);
+      e = cache_find (sector);
+      if (e != NULL)
+        {
+          lock_release (&cache_lock);
+          lock_acquire (&e->lock);
+          if (e->valid && e->sector == sector)
+            {
+              e->accessed = true;
+              *hit = true;
+              return e;
+            }
+
+          /* Evicted while we waited for it.  Start over. */
+          lock_release (&e->lock);
+          continue;
+        }
+
+      e = cache_evict ();
+      if (e == NULL)
+        {
+          /* Every entry is in use or in the running journal
+             transaction.  Have the write-behind thread commit it
+             and let the holders of the rest finish. */
+          lock_release (&cache_lock);
+          lock_acquire (&write_behind_lock);
+          evict_blocked = true;
+          cond_signal (&write_behind_cond, &write_behind_lock);
+          lock_release (&write_behind_lock);
+          thread_yield ();
+          continue;
+        }
+
+      /* Claim the entry for SECTOR before dropping CACHE_LOCK, so
+         that concurrent lookups of SECTOR wait on the entry lock
+         until the data is in place. */
+      e->sector = sector;
+      e->valid = true;
+      e->dirty = false;
+      e->accessed = true;
+      lock_release (&cache_lock);
+
+      if (load)
+        block_read (fs_device, sector, e->data);
+      *hit = false;
+      return e;
+    }
+}
+
+/* Claims an entry for SECTOR on behalf of read-ahead and returns
+   it with its lock held and its data not yet loaded.  Returns a
+   null pointer, without waiting, if SECTOR is already cached or
+   every entry is in use, since read-ahead may hold other claimed
+   entries. */
+static struct cache_entry *
+cache_claim (block_sector_t sector)
+{
+  struct cache_entry *e = NULL;
+
+  lock_acquire (&cache_lock);
+  if (cache_find (sector) == NULL)
+    {
+      e = cache_evict ();
+      if (e != NULL)
+        {
+          e->sector = sector;
+          e->valid = true;
+          e->dirty = false;
+          e->accessed = true;
+        }
+    }
+  lock_release (&cache_lock);
+  return e;
+}
+
+/* Returns the entry that holds SECTOR, or a null pointer if
+   SECTOR is not cached.  CACHE_LOCK must be held. */
+static struct cache_entry *
+cache_find (block_sector_t sector)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  for (i = 0; i < CACHE_SIZE; i++)
+    if (cache[i].valid && cache[i].sector == sector)
+      return &cache[i];
+  return NULL;
+}
+
+/* Chooses an entry to replace using the clock algorithm, writes
+   it back if it is dirty, and returns it invalidated with its
+   lock held.  Entries currently locked, whether by other threads
+   or by the caller itself (read-ahead holds the entries it has
+   claimed, and cache_copy() the first of its two entries), are
+   skipped, and so are entries in the running journal
+   transaction, which must not reach their home locations before
+   it commits.  Returns a null pointer if every entry is in use.
+   CACHE_LOCK must be held, so that nobody can look up the old
+   sector until it has been written back. */
+static struct cache_entry *
+cache_evict (void)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  for (i = 0; i < 2 * CACHE_SIZE; i++)
+    {
+      struct cache_entry *e = &cache[clock_hand];
+      clock_hand = (clock_hand + 1) % CACHE_SIZE;
+
+      if (lock_held_by_current_thread (&e->lock)
+          || !lock_try_acquire (&e->lock))
+        continue;
+      if (e->valid && e->pinned)
+        {
+          lock_release (&e->lock);
+          continue;
+        }
+      if (e->valid && e->accessed)
+        {
+          /* Give it a second chance. */
+          e->accessed = false;
+          lock_release (&e->lock);
+          continue;
+        }
+
+      if (e->valid && e->dirty)
+        write_back (e);
+      if (e->prefetched)
+        ra_miss_cnt++;
+      e->valid = false;
+      e->dirty = false;
+      e->prefetched = false;
+      e->pinned = false;
+      return e;
+    }
+  return NULL;
+}
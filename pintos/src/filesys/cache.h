@@ -0,0 +1,24 @@
+#ifndef FILESYS_CACHE_H
+#define FILESYS_CACHE_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+
+/* Number of sectors held by the buffer cache. */
+#define CACHE_SIZE 64
+
+void cache_configure (int age, int ratio);
+void cache_init (void);
+void cache_read (block_sector_t, void *);
+void cache_write (block_sector_t, const void *);
+void cache_write_through (block_sector_t, const void *);
+void cache_read_at (block_sector_t, void *, off_t size, off_t offset);
+void cache_write_at (block_sector_t, const void *, off_t size, off_t offset);
+void cache_copy (block_sector_t dst, block_sector_t src);
+bool cache_read_ahead (block_sector_t);
+void cache_flush (void);
+void cache_unpin (block_sector_t);
+void cache_print_stats (void);
+
+#endif /* filesys/cache.h */
@@ -0,0 +1,224 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/synch.h"
+
+/* A cached result of looking up NAME in directory PARENT. */
+struct dentry
+  {
+    struct hash_elem hash_elem;         /* Element in dentries. */
+    struct list_elem lru_elem;          /* Element in lru_list or
+                                           free_list. */
+    block_sector_t parent;              /* Directory's inode sector. */
+    block_sector_t child;               /* Entry's inode sector, or
+                                           DCACHE_NEGATIVE. */
+    char name[NAME_MAX + 1];            /* Null terminated name. */
+  };
+
+/* The dentry cache.  Entries in use are indexed by (PARENT, NAME)
+   in DENTRIES, and LRU_LIST orders them from most to least
+   recently used; the rest of POOL is on FREE_LIST.  DCACHE_LOCK
+   protects all of it.
+
+   GEN counts changes made by dcache_update() and dcache_purge().
+   A lookup that misses notes GEN and scans the directory without
+   the lock held; dcache_fill() then drops the result if GEN has
+   moved, since the directory may have changed under the scan. */
+static struct dentry pool[DCACHE_SIZE];
+static struct hash dentries;
+static struct list lru_list;
+static struct list free_list;
+static struct lock dcache_lock;
+static unsigned gen;
+
+/* Statistics. */
+static unsigned long long hit_cnt;      /* Lookups answered positively. */
+static unsigned long long neg_hit_cnt;  /* Lookups answered negatively. */
+static unsigned long long miss_cnt;     /* Lookups not in the cache. */
+
+static hash_hash_func dentry_hash;
+static hash_less_func dentry_less;
+static struct dentry *dentry_find (block_sector_t, const char *);
+static void dentry_set (block_sector_t, const char *, block_sector_t);
+static void dentry_discard (struct dentry *);
+
+/* Initializes the dentry cache. */
+void
+dcache_init (void)
+{
+  size_t i;
+
+  if (!hash_init (&dentries, dentry_hash, dentry_less, NULL))
+    PANIC ("cannot allocate dentry cache");
+  list_init (&lru_list);
+  list_init (&free_list);
+  for (i = 0; i < DCACHE_SIZE; i++)
+    list_push_back (&free_list, &pool[i].lru_elem);
+  lock_init (&dcache_lock);
+}
+
+/* Looks up NAME in directory PARENT.  On a hit, returns true and
+   sets *CHILD to the entry's inode sector, or to DCACHE_NEGATIVE
+   if PARENT has no such entry.  On a miss, returns false and sets
+   *GEN to pass to dcache_fill() once the directory is scanned. */
+bool
+dcache_lookup (block_sector_t parent, const char *name,
+               block_sector_t *child, unsigned *gen_)
+{
+  struct dentry *d;
+
+  if (strlen (name) > NAME_MAX)
+    return false;
+
+  lock_acquire (&dcache_lock);
+  d = dentry_find (parent, name);
+  if (d != NULL)
+    {
+      list_remove (&d->lru_elem);
+      list_push_front (&lru_list, &d->lru_elem);
+      *child = d->child;
+      if (d->child == DCACHE_NEGATIVE)
+        neg_hit_cnt++;
+      else
+        hit_cnt++;
+    }
+  else
+    {
+      *gen_ = gen;
+      miss_cnt++;
+    }
+  lock_release (&dcache_lock);
+  return d != NULL;
+}
+
+/* Records the result of scanning directory PARENT for NAME, which
+   found CHILD (or DCACHE_NEGATIVE), unless the cache has been
+   updated since GEN_ was returned by dcache_lookup(). */
+void
+dcache_fill (block_sector_t parent, const char *name,
+             block_sector_t child, unsigned gen_)
+{
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  lock_acquire (&dcache_lock);
+  if (gen_ == gen)
+    dentry_set (parent, name, child);
+  lock_release (&dcache_lock);
+}
+
+/* Records that NAME in directory PARENT now refers to CHILD, or
+   to nothing if CHILD is DCACHE_NEGATIVE.  Called whenever a
+   directory entry is added or removed. */
+void
+dcache_update (block_sector_t parent, const char *name,
+               block_sector_t child)
+{
+  lock_acquire (&dcache_lock);
+  gen++;
+  if (strlen (name) <= NAME_MAX)
+    dentry_set (parent, name, child);
+  lock_release (&dcache_lock);
+}
+
+/* Drops every entry for names in directory PARENT, whose sector
+   is about to be freed and may be reused by another inode. */
+void
+dcache_purge (block_sector_t parent)
+{
+  struct list_elem *e, *next;
+
+  lock_acquire (&dcache_lock);
+  gen++;
+  for (e = list_begin (&lru_list); e != list_end (&lru_list); e = next)
+    {
+      struct dentry *d = list_entry (e, struct dentry, lru_elem);
+      next = list_next (e);
+      if (d->parent == parent)
+        dentry_discard (d);
+    }
+  lock_release (&dcache_lock);
+}
+
+/* Prints dentry cache statistics. */
+void
+dcache_print_stats (void)
+{
+  printf ("Dentry cache: %zu entries, %llu hits, %llu negative hits, "
+          "%llu misses\n",
+          hash_size (&dentries), hit_cnt, neg_hit_cnt, miss_cnt);
+}
+
+/* Returns the entry for NAME in PARENT, or a null pointer if
+   there is none.  DCACHE_LOCK must be held. */
+static struct dentry *
+dentry_find (block_sector_t parent, const char *name)
+{
+  struct dentry key;
+  struct hash_elem *e;
+
+  key.parent = parent;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dentries, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct dentry, hash_elem) : NULL;
+}
+
+/* Makes NAME in PARENT refer to CHILD, replacing any existing
+   entry and otherwise taking a free entry or evicting the least
+   recently used one.  DCACHE_LOCK must be held. */
+static void
+dentry_set (block_sector_t parent, const char *name, block_sector_t child)
+{
+  struct dentry *d = dentry_find (parent, name);
+
+  if (d == NULL)
+    {
+      if (list_empty (&free_list))
+        dentry_discard (list_entry (list_back (&lru_list),
+                                    struct dentry, lru_elem));
+      d = list_entry (list_pop_front (&free_list), struct dentry, lru_elem);
+      d->parent = parent;
+      strlcpy (d->name, name, sizeof d->name);
+      if (hash_insert (&dentries, &d->hash_elem) != NULL)
+        NOT_REACHED ();
+    }
+  else
+    list_remove (&d->lru_elem);
+  d->child = child;
+  list_push_front (&lru_list, &d->lru_elem);
+}
+
+/* Removes D from the cache and returns it to FREE_LIST.
+   DCACHE_LOCK must be held. */
+static void
+dentry_discard (struct dentry *d)
+{
+  hash_delete (&dentries, &d->hash_elem);
+  list_remove (&d->lru_elem);
+  list_push_back (&free_list, &d->lru_elem);
+}
+
+/* Returns a hash value for the dentry that E is embedded in. */
+static unsigned
+dentry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct dentry *d = hash_entry (e, struct dentry, hash_elem);
+  return hash_int (d->parent) ^ hash_string (d->name);
+}
+
+/* Returns true if dentry A precedes dentry B. */
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct dentry *a = hash_entry (a_, struct dentry, hash_elem);
+  const struct dentry *b = hash_entry (b_, struct dentry, hash_elem);
+
+  if (a->parent != b->parent)
+    return a->parent < b->parent;
+  return strcmp (a->name, b->name) < 0;
+}
@@ -0,0 +1,24 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* Number of name lookups held by the dentry cache. */
+#define DCACHE_SIZE 256
+
+/* Child sector recorded by a negative entry, meaning that the
+   parent directory has no entry by that name. */
+#define DCACHE_NEGATIVE ((block_sector_t) -1)
+
+void dcache_init (void);
+bool dcache_lookup (block_sector_t parent, const char *name,
+                    block_sector_t *child, unsigned *gen);
+void dcache_fill (block_sector_t parent, const char *name,
+                  block_sector_t child, unsigned gen);
+void dcache_update (block_sector_t parent, const char *name,
+                    block_sector_t child);
+void dcache_purge (block_sector_t parent);
+void dcache_print_stats (void);
+
+#endif /* filesys/dcache.h */
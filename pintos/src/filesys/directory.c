@@ -1,9 +1,13 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include <round.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 
 /* A directory. */
@@ -11,6 +15,7 @@ struct dir
   {
     struct inode *inode;                /* Backing store. */
     off_t pos;                          /* Current position. */
+    bool hashed;                        /* Hashed or linear format? */
   };
 
 /* A single directory entry. */
@@ -21,20 +26,90 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* Hashed directories.
+
+   A hashed directory starts with a one-sector header followed
+   by BUCKET_CNT bucket sectors, each an array of ENTRIES_PER_BUCKET
+   directory entries.  A name lives in bucket
+   hash_string(name) & (BUCKET_CNT - 1), so lookup, insertion and
+   removal read the header and one bucket.  When a bucket fills
+   up, BUCKET_CNT doubles and every bucket is split in place.
+
+   Directories written before this format existed are plain
+   arrays of entries and are still searched linearly.  Their
+   first word is the sector number of an inode, which is always
+   far below DIR_MAGIC on an IDE disk, so the two cannot be
+   confused. */
+#define DIR_MAGIC 0x48444952            /* "HDIR". */
+#define ENTRIES_PER_BUCKET (BLOCK_SECTOR_SIZE / sizeof (struct dir_entry))
+#define DIR_MAX_BUCKETS 4096
+
+/* On-disk header of a hashed directory, at offset 0. */
+struct dir_header
+  {
+    uint32_t magic;                     /* DIR_MAGIC. */
+    uint32_t bucket_cnt;                /* Number of buckets, a power of 2. */
+  };
+
+/* Returns the byte offset of bucket B. */
+static inline off_t
+bucket_ofs (size_t b)
+{
+  return (off_t) (b + 1) * BLOCK_SECTOR_SIZE;
+}
+
+/* Returns the bucket for NAME in a directory with BUCKET_CNT
+   buckets. */
+static inline size_t
+bucket_of (const char *name, size_t bucket_cnt)
+{
+  return hash_string (name) & (bucket_cnt - 1);
+}
+
+static bool hashed_lookup (const struct dir *, const char *name,
+                           struct dir_entry *, off_t *ofsp, off_t *freep);
+
+/* Returns the number of buckets in hashed directory DIR. */
+static size_t
+bucket_cnt (const struct dir *dir)
+{
+  struct dir_header h;
+
+  if (inode_read_at (dir->inode, &h, sizeof h, 0) != sizeof h)
+    return 0;
+  return h.bucket_cnt;
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool
 dir_create (block_sector_t sector, size_t entry_cnt)
 {
-  if (inode_create (sector, entry_cnt * sizeof (struct dir_entry)))
+  struct dir_header h;
+  struct inode *inode;
+  bool success;
+
+  h.magic = DIR_MAGIC;
+  h.bucket_cnt = 1;
+  while (h.bucket_cnt * ENTRIES_PER_BUCKET < entry_cnt)
+    h.bucket_cnt *= 2;
+
+  journal_begin ();
+  success = inode_create (sector, bucket_ofs (h.bucket_cnt));
+  if (success)
     {
-      struct inode *inode = inode_open (sector);
-      set_dir (inode);
-      inode_close (inode);
-      return true;
+      inode = inode_open (sector);
+      if (inode != NULL)
+        {
+          set_dir (inode);
+          success = inode_write_at (inode, &h, sizeof h, 0) == sizeof h;
+          inode_close (inode);
+        }
+      else
+        success = false;
     }
-  else 
-    return false;
+  journal_end ();
+  return success;
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -45,8 +120,12 @@ dir_open (struct inode *inode)
   struct dir *dir = calloc (1, sizeof *dir);
   if (inode != NULL && dir != NULL)
     {
+      struct dir_header h;
+
       dir->inode = inode;
-      dir->pos = (inode_get_inumber (inode) != ROOT_DIR_SECTOR) ? 2 * sizeof (struct dir_entry) : 0;
+      dir->hashed = (inode_read_at (inode, &h, sizeof h, 0) == sizeof h
+                     && h.magic == DIR_MAGIC);
+      dir->pos = dir->hashed ? bucket_ofs (0) : 0;
       return dir;
     }
   else
@@ -106,6 +185,9 @@ lookup (const struct dir *dir, const char *name,
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  if (dir->hashed)
+    return hashed_lookup (dir, name, ep, ofsp, NULL);
+
   for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
        ofs += sizeof e)
     if (e.in_use && !strcmp (name, e.name))
@@ -119,6 +201,107 @@ lookup (const struct dir *dir, const char *name,
   return false;
 }
 
+/* Searches the bucket of hashed directory DIR that NAME belongs
+   in, as lookup() does.  If FREEP is non-null, also sets *FREEP
+   to the offset of a free slot in the bucket, or to -1 if the
+   bucket is full.  Entries left behind in a bucket by
+   split_buckets() count as free slots. */
+static bool
+hashed_lookup (const struct dir *dir, const char *name,
+               struct dir_entry *ep, off_t *ofsp, off_t *freep)
+{
+  struct dir_entry bucket[ENTRIES_PER_BUCKET];
+  size_t cnt = bucket_cnt (dir);
+  off_t base;
+  size_t b, i;
+
+  if (freep != NULL)
+    *freep = -1;
+  if (cnt == 0)
+    return false;
+
+  b = bucket_of (name, cnt);
+  base = bucket_ofs (b);
+  if (inode_read_at (dir->inode, bucket, sizeof bucket, base)
+      != sizeof bucket)
+    return false;
+
+  for (i = 0; i < ENTRIES_PER_BUCKET; i++)
+    if (!bucket[i].in_use || bucket_of (bucket[i].name, cnt) != b)
+      {
+        if (freep != NULL && *freep == -1)
+          *freep = base + i * sizeof *bucket;
+      }
+    else if (!strcmp (name, bucket[i].name))
+      {
+        if (ep != NULL)
+          *ep = bucket[i];
+        if (ofsp != NULL)
+          *ofsp = base + i * sizeof *bucket;
+        return true;
+      }
+  return false;
+}
+
+/* Doubles the number of buckets in hashed directory DIR, copying
+   each entry whose hash has the new bit set from bucket B to
+   bucket B + the old count.  The copies in bucket B are left in
+   place and become free slots once the new count is published,
+   so that a crash part way through loses nothing: until then
+   the new buckets are not looked at.  Returns true if
+   successful, false if the directory is already at its maximum
+   size or a disk or memory error occurs. */
+static bool
+split_buckets (struct dir *dir)
+{
+  struct dir_header h;
+  struct dir_entry *old, *new;
+  size_t b, i, j;
+  bool success = false;
+  bool written;
+
+  if (inode_read_at (dir->inode, &h, sizeof h, 0) != sizeof h
+      || h.bucket_cnt >= DIR_MAX_BUCKETS)
+    return false;
+
+  old = malloc (BLOCK_SECTOR_SIZE);
+  new = malloc (BLOCK_SECTOR_SIZE);
+  if (old == NULL || new == NULL)
+    goto done;
+
+  for (b = 0; b < h.bucket_cnt; b++)
+    {
+      off_t size = ENTRIES_PER_BUCKET * sizeof *old;
+
+      if (inode_read_at (dir->inode, old, size, bucket_ofs (b)) != size)
+        goto done;
+      memset (new, 0, size);
+      for (i = j = 0; i < ENTRIES_PER_BUCKET; i++)
+        if (old[i].in_use && bucket_of (old[i].name, h.bucket_cnt) == b
+            && (hash_string (old[i].name) & h.bucket_cnt))
+          new[j++] = old[i];
+
+      journal_begin ();
+      written = inode_write_at (dir->inode, new, size,
+                                bucket_ofs (b + h.bucket_cnt)) == size;
+      journal_end ();
+      if (!written)
+        goto done;
+    }
+
+  /* Publish the new bucket count only once every entry is in
+     the bucket it will be looked up in. */
+  h.bucket_cnt *= 2;
+  journal_begin ();
+  success = inode_write_at (dir->inode, &h, sizeof h, 0) == sizeof h;
+  journal_end ();
+
+ done:
+  free (old);
+  free (new);
+  return success;
+}
+
 /* Searches DIR for a file with the given NAME
    and returns true if one exists, false otherwise.
    On success, sets *INODE to an inode for the file, otherwise to
@@ -127,13 +310,22 @@ bool
 dir_lookup (const struct dir *dir, const char *name,
             struct inode **inode)
 {
+  block_sector_t parent = inode_get_inumber (dir->inode);
+  block_sector_t sector;
   struct dir_entry e;
+  unsigned gen;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  if (lookup (dir, name, &e, NULL))
-    *inode = inode_open (e.inode_sector);
+  if (!dcache_lookup (parent, name, &sector, &gen))
+    {
+      sector = lookup (dir, name, &e, NULL) ? e.inode_sector : DCACHE_NEGATIVE;
+      dcache_fill (parent, name, sector, gen);
+    }
+
+  if (sector != DCACHE_NEGATIVE)
+    *inode = inode_open (sector);
   else
     *inode = NULL;
 
@@ -160,27 +352,47 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   if (*name == '\0' || strlen (name) > NAME_MAX)
     return false;
 
-  /* Check that NAME is not in use. */
-  if (lookup (dir, name, NULL, NULL))
-    goto done;
+  if (dir->hashed)
+    {
+      /* Check that NAME is not in use and find a free slot in
+         its bucket, splitting buckets until there is one. */
+      if (hashed_lookup (dir, name, NULL, NULL, &ofs))
+        goto done;
+      while (ofs == -1)
+        if (!split_buckets (dir)
+            || hashed_lookup (dir, name, NULL, NULL, &ofs))
+          goto done;
+    }
+  else
+    {
+      /* Check that NAME is not in use. */
+      if (lookup (dir, name, NULL, NULL))
+        goto done;
 
-  /* Set OFS to offset of free slot.
-     If there are no free slots, then it will be set to the
-     current end-of-file.
+      /* Set OFS to offset of free slot.
+         If there are no free slots, then it will be set to the
+         current end-of-file.
 
-     inode_read_at() will only return a short read at end of file.
-     Otherwise, we'd need to verify that we didn't get a short
-     read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e)
-    if (!e.in_use)
-      break;
+         inode_read_at() will only return a short read at end of
+         file.  Otherwise, we'd need to verify that we didn't get
+         a short read due to something intermittent such as low
+         memory. */
+      for (ofs = 0;
+           inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+           ofs += sizeof e)
+        if (!e.in_use)
+          break;
+    }
 
   /* Write slot. */
   e.in_use = true;
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
+  journal_begin ();
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+  journal_end ();
+  if (success)
+    dcache_update (inode_get_inumber (dir->inode), name, inode_sector);
  done:
   return success;
 }
@@ -199,6 +411,8 @@ dir_remove (struct dir *dir, const char *name)
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  journal_begin ();
+
   /* Find directory entry. */
   if (!lookup (dir, name, &e, &ofs))
     goto done;
@@ -212,31 +426,54 @@ dir_remove (struct dir *dir, const char *name)
   e.in_use = false;
   if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
     goto done;
+  dcache_update (inode_get_inumber (dir->inode), name, DCACHE_NEGATIVE);
+  dcache_purge (e.inode_sector);
 
   /* Remove inode. */
   inode_remove (inode);
   success = true;
  done:
   inode_close (inode);
+  journal_end ();
   return success;
 }
 
+/* Returns true if entry E, read from offset OFS of hashed
+   directory DIR, was left behind by split_buckets() and so is
+   really a free slot. */
+static bool
+is_stale (const struct dir *dir, const struct dir_entry *e, off_t ofs)
+{
+  size_t b = ofs / BLOCK_SECTOR_SIZE - 1;
+
+  return bucket_of (e->name, bucket_cnt (dir)) != b;
+}
+
 /* Reads the next directory entry in DIR and stores the name in
    NAME.  Returns true if successful, false if the directory
-   contains no more entries. */
+   contains no more entries.  The "." and ".." entries are
+   skipped. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
   struct dir_entry e;
 
-  while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e)
+  for (;;)
     {
+      /* Entries of a hashed directory do not straddle sectors. */
+      if (dir->hashed
+          && dir->pos % BLOCK_SECTOR_SIZE
+             > (off_t) (BLOCK_SECTOR_SIZE - sizeof e))
+        dir->pos = ROUND_UP (dir->pos, BLOCK_SECTOR_SIZE);
+
+      if (inode_read_at (dir->inode, &e, sizeof e, dir->pos) != sizeof e)
+        return false;
       dir->pos += sizeof e;
-      if (e.in_use)
+      if (e.in_use && strcmp (e.name, ".") && strcmp (e.name, "..")
+          && !(dir->hashed && is_stale (dir, &e, dir->pos - sizeof e)))
         {
           strlcpy (name, e.name, NAME_MAX + 1);
           return true;
         }
     }
-  return false;
 }
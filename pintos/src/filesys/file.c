@@ -2,6 +2,16 @@
 #include <debug.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Bounds on the read-ahead window, in sectors.  The window starts
+   at the minimum when a sequential stream is detected and doubles
+   with each further sequential read. */
+#define RA_MIN_WINDOW 4
+#define RA_MAX_WINDOW 16
+
+static void file_read_ahead (struct file *, off_t ofs, off_t size);
 
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
@@ -15,6 +25,9 @@ file_open (struct inode *inode)
       file->inode = inode;
       file->pos = 0;
       file->deny_write = false;
+      file->ra_next = 0;
+      file->ra_end = 0;
+      file->ra_window = 0;
       return file;
     }
   else
@@ -61,10 +74,49 @@ off_t
 file_read (struct file *file, void *buffer, off_t size)
 {
   off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+  file_read_ahead (file, file->pos, bytes_read);
   file->pos += bytes_read;
   return bytes_read;
 }
 
+/* Updates FILE's access pattern for a read of SIZE bytes at
+   offset OFS.  While reads form a sequential stream, asks for the
+   sectors following the read to be read ahead, growing the window
+   on each sequential read and shrinking it when the read-ahead
+   queue cannot keep up. */
+static void
+file_read_ahead (struct file *file, off_t ofs, off_t size)
+{
+  off_t end = ofs + size;
+  off_t start, target;
+
+  if (size <= 0)
+    return;
+
+  if (ofs != file->ra_next)
+    {
+      /* Not sequential: stop reading ahead. */
+      file->ra_window = 0;
+      file->ra_end = end;
+    }
+  else if (file->ra_window == 0)
+    file->ra_window = RA_MIN_WINDOW;
+  else if (file->ra_window < RA_MAX_WINDOW)
+    file->ra_window *= 2;
+  file->ra_next = end;
+
+  if (file->ra_window == 0)
+    return;
+  start = file->ra_end > end ? file->ra_end : end;
+  target = end + file->ra_window * BLOCK_SECTOR_SIZE;
+  if (start >= target)
+    return;
+  if (inode_read_ahead (file->inode, start, target - start))
+    file->ra_end = target;
+  else
+    file->ra_window /= 2;
+}
+
 /* Reads SIZE bytes from FILE into BUFFER,
    starting at offset FILE_OFS in the file.
    Returns the number of bytes actually read,
@@ -91,6 +143,117 @@ file_write (struct file *file, const void *buffer, off_t size)
   return bytes_written;
 }
 
+/* Reads into the IOV_CNT buffers in IOV from FILE in turn,
+   starting at the file's current position, until they are full
+   or end of file is reached.  Returns the number of bytes
+   actually read and advances FILE's position by that many. */
+off_t
+file_readv (struct file *file, const struct iovec *iov, int iov_cnt)
+{
+  off_t bytes_read = 0;
+  int i;
+
+  for (i = 0; i < iov_cnt; i++)
+    {
+      off_t n = file_read (file, iov[i].iov_base, iov[i].iov_len);
+      bytes_read += n;
+      if (n < (off_t) iov[i].iov_len)
+        break;
+    }
+  return bytes_read;
+}
+
+/* Writes the IOV_CNT buffers in IOV into FILE one after another,
+   starting at the file's current position, as a single write.
+   Returns the number of bytes actually written and advances
+   FILE's position by that many. */
+off_t
+file_writev (struct file *file, const struct iovec *iov, int iov_cnt)
+{
+  off_t bytes_written = inode_writev (file->inode, iov, iov_cnt, file->pos);
+  file->pos += bytes_written;
+  return bytes_written;
+}
+
+/* Copies up to SIZE bytes from SRC, starting at its current
+   position, to DST at its current position, and advances both
+   positions past the bytes copied.  The copy stops early at the
+   end of SRC or if DST cannot be written.  The two ranges must
+   not overlap within one file.
+
+   Where both positions are sector-aligned, whole sectors are
+   copied from one buffer cache entry to another.  Only bytes
+   that cannot be copied that way, the partial sectors at either
+   end or everything if the two positions are not aligned alike,
+   go through a page-sized kernel buffer, in chunks that end on
+   DST's sector boundaries.  Space for the whole destination
+   range is reserved in advance, so that it is allocated in as
+   few runs as possible.  Returns the number of bytes copied. */
+off_t
+file_copy (struct file *dst, struct file *src, off_t size)
+{
+  off_t src_left = inode_length (src->inode) - src->pos;
+  off_t copied = 0;
+  uint8_t *buffer = NULL;
+
+  if (size > src_left)
+    size = src_left;
+  if (size <= 0)
+    return 0;
+
+  /* Reserving fails without allocating anything if writes to DST
+     are denied, and then so does the first write below.  If the
+     disk fills up, as much is copied as fits. */
+  inode_reserve (dst->inode, dst->pos, size);
+
+  while (copied < size)
+    {
+      off_t left = size - copied;
+      int dst_ofs = dst->pos % BLOCK_SECTOR_SIZE;
+      off_t chunk, bytes_read, bytes_written;
+
+      if (dst_ofs == 0 && src->pos % BLOCK_SECTOR_SIZE == 0
+          && left >= BLOCK_SECTOR_SIZE)
+        {
+          bytes_written = inode_copy_sectors (dst->inode, dst->pos,
+                                              src->inode, src->pos,
+                                              left / BLOCK_SECTOR_SIZE);
+          if (bytes_written > 0)
+            {
+              src->pos += bytes_written;
+              dst->pos += bytes_written;
+              copied += bytes_written;
+              continue;
+            }
+        }
+
+      if (buffer == NULL)
+        {
+          buffer = palloc_get_page (0);
+          if (buffer == NULL)
+            break;
+        }
+      if (dst_ofs == src->pos % BLOCK_SECTOR_SIZE)
+        chunk = BLOCK_SECTOR_SIZE - dst_ofs;
+      else
+        chunk = PGSIZE - dst_ofs;
+      if (chunk > left)
+        chunk = left;
+      bytes_read = inode_read_at (src->inode, buffer, chunk, src->pos);
+      if (bytes_read <= 0)
+        break;
+      bytes_written = inode_write_at (dst->inode, buffer, bytes_read,
+                                      dst->pos);
+      src->pos += bytes_written;
+      dst->pos += bytes_written;
+      copied += bytes_written;
+      if (bytes_written < bytes_read)
+        break;
+    }
+  palloc_free_page (buffer);
+  return copied;
+}
+
 /* Writes SIZE bytes from BUFFER into FILE,
    starting at offset FILE_OFS in the file.
    Returns the number of bytes actually written,
@@ -105,6 +268,19 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Allocates disk space for the SIZE bytes of FILE starting at
+   byte FILE_OFS, so that writing them later does no allocation.
+   Does not change the file's length, and bytes past the end of
+   file still read as zeros once a write extends the file over
+   them.  Returns true if successful, false if writes to FILE are
+   denied or the disk is full.
+   The file's current position is unaffected. */
+bool
+file_reserve (struct file *file, off_t size, off_t file_ofs)
+{
+  return inode_reserve (file->inode, file_ofs, size);
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
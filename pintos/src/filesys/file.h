@@ -1,6 +1,7 @@
 #ifndef FILESYS_FILE_H
 #define FILESYS_FILE_H
 
+#include <iovec.h>
 #include <stdbool.h>
 #include "filesys/off_t.h"
 
@@ -11,6 +12,9 @@ struct file
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    off_t ra_next;              /* Offset a sequential read would start at. */
+    off_t ra_end;               /* End of the range already read ahead. */
+    int ra_window;              /* Sectors to read ahead, 0 if not sequential. */
   };
 /* Opening and closing files. */
 struct file *file_open (struct inode *);
@@ -23,6 +27,10 @@ off_t file_read (struct file *, void *, off_t);
 off_t file_read_at (struct file *, void *, off_t size, off_t start);
 off_t file_write (struct file *, const void *, off_t);
 off_t file_write_at (struct file *, const void *, off_t size, off_t start);
+off_t file_readv (struct file *, const struct iovec *, int iov_cnt);
+off_t file_writev (struct file *, const struct iovec *, int iov_cnt);
+off_t file_copy (struct file *dst, struct file *src, off_t size);
+bool file_reserve (struct file *, off_t size, off_t start);
 
 /* Preventing writes. */
 void file_deny_write (struct file *);
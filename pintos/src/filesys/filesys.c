@@ -2,9 +2,12 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
+#include "filesys/dcache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "filesys/directory.h"
 #include "../userprog/syscall.h"
 /* Partition that contains the file system. */
@@ -21,7 +24,11 @@ filesys_init (bool format)
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  cache_init ();
+  if (!format)
+    journal_open ();
   inode_init ();
+  dcache_init ();
   free_map_init ();
 
   if (format)
@@ -35,7 +42,12 @@ filesys_init (bool format)
 void
 filesys_done (void)
 {
+  /* The first checkpoint returns released sectors to the free
+     map, which the second then commits. */
+  journal_done ();
   free_map_close ();
+  journal_done ();
+  cache_flush ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -103,6 +115,7 @@ do_format (void)
 {
   printf ("Formatting file system...");
   free_map_create ();
+  journal_create ();
   if (!dir_create (ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
   free_map_close ();
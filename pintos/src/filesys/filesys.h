@@ -6,6 +6,7 @@
 
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
+#define JOURNAL_SECTOR 1        /* Journal superblock sector. */
 #define ROOT_DIR_SECTOR 4       /* Root directory file inode sector. */
 
 /* Block device that contains the file system. */
@@ -1,14 +1,40 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "../threads/synch.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
 static struct lock free_map_lock;    /* Free map lock */
+static struct bitmap *dirty_map;     /* Free map file sectors changed
+                                        since they were last written. */
+
+/* Runs of sectors released since the last journal checkpoint.
+   They are not reused until then, because a transaction still in
+   the log might otherwise be replayed over their new contents. */
+struct deferred_run
+  {
+    block_sector_t sector;              /* First sector. */
+    size_t cnt;                         /* Number of sectors. */
+  };
+static struct deferred_run *deferred;   /* Array of runs. */
+static size_t deferred_cnt;             /* Number of runs in use. */
+static size_t deferred_cap;             /* Number of runs allocated. */
+
+/* Number of free map bits stored in one sector of its file. */
+#define BITS_PER_SECTOR (BLOCK_SECTOR_SIZE * 8)
+
+static bool allocate (size_t, block_sector_t *);
+static size_t allocate_run (size_t, block_sector_t *);
+static bool reclaim_deferred (void);
+static void mark_dirty (block_sector_t, size_t);
+static bool defer_release (block_sector_t, size_t);
 
 /* Initializes the free map. */
 void
@@ -22,39 +48,229 @@ free_map_init (void)
   bitmap_mark (free_map, FREE_MAP_SECTOR + 2);
   bitmap_mark (free_map, FREE_MAP_SECTOR + 3);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  dirty_map = bitmap_create (DIV_ROUND_UP (bitmap_file_size (free_map),
+                                           BLOCK_SECTOR_SIZE));
+  if (dirty_map == NULL)
+    PANIC ("bitmap creation failed--file system device is too large");
   lock_init (&free_map_lock);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
    the first into *SECTORP.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
-   written. */
+   sectors were available.  The change reaches the free map file
+   at the next free_map_flush().  If the sectors are only
+   unavailable because they were released since the last journal
+   checkpoint, forces a checkpoint and tries again. */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
+{
+  return (allocate (cnt, sectorp)
+          || (reclaim_deferred () && allocate (cnt, sectorp)));
+}
+
+/* Allocates the longest run of free consecutive sectors no longer
+   than CNT, preferring a run of exactly CNT, and stores the first
+   into *SECTORP.  Returns the number of sectors allocated, which
+   is 0 if the disk is full.  Like free_map_allocate(), reclaims
+   sectors awaiting a journal checkpoint before giving up. */
+size_t
+free_map_allocate_run (size_t cnt, block_sector_t *sectorp)
+{
+  size_t got = allocate_run (cnt, sectorp);
+
+  if (got == 0 && reclaim_deferred ())
+    got = allocate_run (cnt, sectorp);
+  return got;
+}
+
+/* Makes the sectors released since the last journal checkpoint
+   available by forcing a checkpoint, if there are any and the
+   current thread is not inside a journal update.  Returns true if
+   that freed anything, so that a failed allocation is worth
+   retrying.  Callers inside an update, which cannot wait for the
+   transaction to commit, are left to retry once it is over. */
+static bool
+reclaim_deferred (void)
+{
+  return free_map_has_deferred () && journal_checkpoint ();
+}
+
+/* Allocates CNT consecutive sectors, as free_map_allocate() does
+   but without reclaiming deferred releases. */
+static bool
+allocate (size_t cnt, block_sector_t *sectorp)
 {
   lock_acquire (&free_map_lock);
   block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+  if (sector != BITMAP_ERROR)
     {
-      bitmap_set_multiple (free_map, sector, cnt, false);
-      sector = BITMAP_ERROR;
+      mark_dirty (sector, cnt);
+      *sectorp = sector;
     }
-  if (sector != BITMAP_ERROR)
-    *sectorp = sector;
   lock_release (&free_map_lock);
   return sector != BITMAP_ERROR;
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Allocates a run of up to CNT sectors, as free_map_allocate_run()
+   does but without reclaiming deferred releases. */
+static size_t
+allocate_run (size_t cnt, block_sector_t *sectorp)
+{
+  size_t best_cnt = 0;
+  size_t best = 0;
+  size_t start;
+
+  lock_acquire (&free_map_lock);
+  for (start = 0; best_cnt < cnt; )
+    {
+      size_t end;
+
+      start = bitmap_scan (free_map, start, 1, false);
+      if (start == BITMAP_ERROR)
+        break;
+      end = bitmap_scan (free_map, start, 1, true);
+      if (end == BITMAP_ERROR)
+        end = bitmap_size (free_map);
+      if (end - start > best_cnt)
+        {
+          best = start;
+          best_cnt = end - start < cnt ? end - start : cnt;
+        }
+      start = end;
+    }
+  if (best_cnt > 0)
+    {
+      bitmap_set_multiple (free_map, best, best_cnt, true);
+      mark_dirty (best, best_cnt);
+      *sectorp = best;
+    }
+  lock_release (&free_map_lock);
+  return best_cnt;
+}
+
+/* Allocates as many as CNT sectors starting exactly at SECTOR,
+   stopping at the first one that is already in use or past the
+   end of the disk.  Returns the number of sectors allocated. */
+size_t
+free_map_allocate_at (block_sector_t sector, size_t cnt)
+{
+  size_t i;
+
+  lock_acquire (&free_map_lock);
+  for (i = 0; i < cnt && sector + i < bitmap_size (free_map); i++)
+    if (bitmap_test (free_map, sector + i))
+      break;
+  if (i > 0)
+    {
+      bitmap_set_multiple (free_map, sector, i, true);
+      mark_dirty (sector, i);
+    }
+  lock_release (&free_map_lock);
+  return i;
+}
+
+/* Makes CNT sectors starting at SECTOR available for use.  The
+   change reaches the free map file at the next
+   free_map_flush().  With a journal, the sectors only become
+   available at the next journal checkpoint. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
-  bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  if (!journal_active () || !defer_release (sector, cnt))
+    {
+      bitmap_set_multiple (free_map, sector, cnt, false);
+      mark_dirty (sector, cnt);
+    }
+  lock_release (&free_map_lock);
+}
+
+/* Makes the sectors released since the last journal checkpoint
+   available for use.  Called by the journal at a checkpoint. */
+void
+free_map_release_deferred (void)
+{
+  size_t i;
+
+  lock_acquire (&free_map_lock);
+  for (i = 0; i < deferred_cnt; i++)
+    {
+      bitmap_set_multiple (free_map, deferred[i].sector, deferred[i].cnt,
+                           false);
+      mark_dirty (deferred[i].sector, deferred[i].cnt);
+    }
+  deferred_cnt = 0;
+  lock_release (&free_map_lock);
+}
+
+/* Returns true if any released sectors are waiting for a journal
+   checkpoint. */
+bool
+free_map_has_deferred (void)
+{
+  return deferred_cnt > 0;
+}
+
+/* Records CNT sectors starting at SECTOR to be released at the
+   next journal checkpoint.  Returns false if memory runs out, in
+   which case the caller releases them immediately. */
+static bool
+defer_release (block_sector_t sector, size_t cnt)
+{
+  ASSERT (lock_held_by_current_thread (&free_map_lock));
+
+  if (deferred_cnt == deferred_cap)
+    {
+      size_t cap = deferred_cap > 0 ? deferred_cap * 2 : 16;
+      struct deferred_run *d = realloc (deferred, cap * sizeof *d);
+      if (d == NULL)
+        return false;
+      deferred = d;
+      deferred_cap = cap;
+    }
+  deferred[deferred_cnt].sector = sector;
+  deferred[deferred_cnt].cnt = cnt;
+  deferred_cnt++;
+  return true;
+}
+
+/* Writes the sectors of the free map file whose bits have changed
+   since they were last written, leaving the rest alone, as one
+   journal update. */
+void
+free_map_flush (void)
+{
+  size_t i;
+
+  journal_begin ();
+  lock_acquire (&free_map_lock);
+  if (free_map_file != NULL)
+    for (i = 0; (i = bitmap_scan (dirty_map, i, 1, true)) != BITMAP_ERROR;
+         i++)
+      {
+        size_t start = i * BITS_PER_SECTOR;
+        size_t cnt = bitmap_size (free_map) - start;
+        if (cnt > BITS_PER_SECTOR)
+          cnt = BITS_PER_SECTOR;
+        if (bitmap_write_range (free_map, free_map_file, start, cnt))
+          bitmap_reset (dirty_map, i);
+      }
+  lock_release (&free_map_lock);
+  journal_end ();
+}
+
+/* Marks the free map file sectors that hold the bits for the CNT
+   sectors starting at SECTOR as needing to be written. */
+static void
+mark_dirty (block_sector_t sector, size_t cnt)
+{
+  size_t first = sector / BITS_PER_SECTOR;
+  size_t last = (sector + cnt - 1) / BITS_PER_SECTOR;
+
+  if (cnt > 0)
+    bitmap_set_multiple (dirty_map, first, last - first + 1, true);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -72,6 +288,7 @@ free_map_open (void)
 void
 free_map_close (void)
 {
+  free_map_flush ();
   file_close (free_map_file);
 }
 
@@ -90,4 +307,5 @@ free_map_create (void)
     PANIC ("can't open free map");
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
+  bitmap_set_all (dirty_map, false);
 }
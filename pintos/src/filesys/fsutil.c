@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -66,25 +67,69 @@ fsutil_rm (char **argv)
     PANIC ("%s: delete failed\n", file_name);
 }
 
+/* Number of sectors that fsutil_extract() reads from the scratch
+   device at a time. */
+#define EXTRACT_PAGES 8
+#define EXTRACT_SECTORS (EXTRACT_PAGES * PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A window onto a ustar archive on a block device, refilled
+   EXTRACT_SECTORS at a time. */
+struct archive
+  {
+    struct block *dev;                  /* Device holding the archive. */
+    uint8_t *buffer;                    /* EXTRACT_SECTORS sectors. */
+    block_sector_t start;               /* First sector in BUFFER. */
+    size_t cnt;                         /* Number of sectors in BUFFER. */
+  };
+
+/* Returns a pointer to the contents of SECTOR of archive A,
+   reading it and the sectors after it from the device if they
+   are not already buffered.  On entry, *CNT is the number of
+   consecutive sectors wanted; on return, it is the number
+   available at the returned pointer, which is at least 1. */
+static const uint8_t *
+archive_read (struct archive *a, block_sector_t sector, size_t *cnt)
+{
+  if (sector < a->start || sector >= a->start + a->cnt)
+    {
+      block_sector_t dev_size = block_size (a->dev);
+
+      if (sector >= dev_size)
+        PANIC ("ustar archive runs past end of scratch device");
+      a->start = sector;
+      a->cnt = dev_size - sector;
+      if (a->cnt > EXTRACT_SECTORS)
+        a->cnt = EXTRACT_SECTORS;
+      block_read_multi (a->dev, a->start, a->cnt, a->buffer);
+    }
+  if (*cnt > a->start + a->cnt - sector)
+    *cnt = a->start + a->cnt - sector;
+  return a->buffer + (sector - a->start) * BLOCK_SECTOR_SIZE;
+}
+
 /* Extracts a ustar-format tar archive from the scratch block
-   device into the Pintos file system. */
+   device into the Pintos file system.  The archive is read in
+   batches of EXTRACT_SECTORS, and each file's data is written a
+   batch at a time, which lets the inode allocate it as a few
+   long runs of sectors. */
 void
 fsutil_extract (char **argv UNUSED)
 {
   static block_sector_t sector = 0;
 
-  struct block *src;
-  void *header, *data;
+  struct archive a;
+  void *header;
 
   /* Allocate buffers. */
   header = malloc (BLOCK_SECTOR_SIZE);
-  data = malloc (BLOCK_SECTOR_SIZE);
-  if (header == NULL || data == NULL)
+  a.buffer = palloc_get_multiple (0, EXTRACT_PAGES);
+  if (header == NULL || a.buffer == NULL)
     PANIC ("couldn't allocate buffers");
+  a.start = a.cnt = 0;
 
   /* Open source block device. */
-  src = block_get_role (BLOCK_SCRATCH);
-  if (src == NULL)
+  a.dev = block_get_role (BLOCK_SCRATCH);
+  if (a.dev == NULL)
     PANIC ("couldn't open scratch device");
 
   printf ("Extracting ustar archive from scratch device "
@@ -95,10 +140,11 @@ fsutil_extract (char **argv UNUSED)
       const char *file_name;
       const char *error;
       enum ustar_type type;
+      size_t cnt = 1;
       int size;
 
       /* Read and parse ustar header. */
-      block_read (src, sector++, header);
+      memcpy (header, archive_read (&a, sector++, &cnt), BLOCK_SECTOR_SIZE);
       error = ustar_parse_header (header, &file_name, &type, &size);
       if (error != NULL)
         PANIC ("bad ustar header in sector %"PRDSNu" (%s)", sector - 1, error);
@@ -123,16 +169,21 @@ fsutil_extract (char **argv UNUSED)
           if (dst == NULL)
             PANIC ("%s: open failed", file_name);
 
-          /* Do copy. */
+          /* Do copy, as many sectors at a time as are buffered. */
           while (size > 0)
             {
-              int chunk_size = (size > BLOCK_SECTOR_SIZE
-                                ? BLOCK_SECTOR_SIZE
-                                : size);
-              block_read (src, sector++, data);
+              const uint8_t *data;
+              int chunk_size;
+
+              cnt = DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
+              data = archive_read (&a, sector, &cnt);
+              chunk_size = (size > (int) (cnt * BLOCK_SECTOR_SIZE)
+                            ? (int) (cnt * BLOCK_SECTOR_SIZE)
+                            : size);
               if (file_write (dst, data, chunk_size) != chunk_size)
                 PANIC ("%s: write failed with %d bytes unwritten",
                        file_name, size);
+              sector += cnt;
               size -= chunk_size;
             }
 
@@ -147,10 +198,10 @@ fsutil_extract (char **argv UNUSED)
      end-of-archive marker. */
   printf ("Erasing ustar archive...\n");
   memset (header, 0, BLOCK_SECTOR_SIZE);
-  block_write (src, 0, header);
-  block_write (src, 1, header);
+  block_write (a.dev, 0, header);
+  block_write (a.dev, 1, header);
 
-  free (data);
+  palloc_free_multiple (a.buffer, EXTRACT_PAGES);
   free (header);
 }
 
@@ -1,11 +1,15 @@
 #include "filesys/inode.h"
+#include <hash.h>
 #include <list.h>
 #include <debug.h>
+#include <stdio.h>
 #include <round.h>
 #include <string.h>
 #include "../threads/synch.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 #include "../filesys/directory.h"
 #include "threads/thread.h"
@@ -14,6 +18,33 @@
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Layouts of an inode's block pointers, selected by the FORMAT
+   member of struct inode_disk.  Inodes written before the format
+   member existed have zero there and so read as INODE_INDEXED. */
+#define INODE_INDEXED 0         /* Direct, indirect, doubly indirect. */
+#define INODE_EXTENTS 1         /* Array of extents. */
+
+/* A run of LENGTH consecutive sectors starting at sector START,
+   holding file blocks BLOCK through BLOCK + LENGTH - 1. */
+struct extent
+  {
+    uint32_t block;                     /* First file block. */
+    block_sector_t start;               /* First sector. */
+    uint32_t length;                    /* Number of sectors. */
+  };
+
+/* Number of extents that fit in an on-disk inode. */
+#define EXTENT_CNT 41
+
+/* Number of file blocks the indexed format can address. */
+#define INDEXED_MAX_BLOCKS (123 + 128 + 128 * 128)
+
+/* Maximum number of blocks that inode_fill_hole() allocates at
+   once.  Keeps the index blocks that one journal update modifies
+   to a handful: at most two children of the doubly indirect block
+   plus the indirect and doubly indirect blocks themselves. */
+#define FILL_MAX_BLOCKS 128
+
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
 struct inode_disk
@@ -21,9 +52,21 @@ struct inode_disk
     // block_sector_t start;               /* First data sector. */
     off_t length;                       /* File size in bytes. */
     bool is_dir;
-    block_sector_t direct[123];
-    block_sector_t indirect;
-    block_sector_t doubly_indirect;
+    uint8_t format;                     /* INODE_INDEXED or INODE_EXTENTS. */
+    union
+      {
+        struct                          /* INODE_INDEXED. */
+          {
+            block_sector_t direct[123];
+            block_sector_t indirect;
+            block_sector_t doubly_indirect;
+          };
+        struct                          /* INODE_EXTENTS. */
+          {
+            uint32_t extent_cnt;        /* Number of extents in use. */
+            struct extent extents[EXTENT_CNT]; /* In file block order. */
+          };
+      };
     unsigned magic;                     /* Magic number. */
     // uint32_t unused[125];               /* Not used. */
   };
@@ -33,31 +76,26 @@ struct indirect_inode
     block_sector_t blocks[128];
   };
 
-block_sector_t 
-get_block_sector (size_t index, struct inode_disk* block) 
-{
-  if (index < 123) 
-    {
-      return block->direct[index];
-    } 
-  else if (index < 123 + 128) 
-    {
-      struct indirect_inode* indirect_block = calloc (1, BLOCK_SECTOR_SIZE);
-      block_read (fs_device, block->indirect, indirect_block);
-      block_sector_t result = indirect_block->blocks[index - 123];
-      free (indirect_block);
-      return result;
-    } 
-  struct indirect_inode* doubly = calloc (1, BLOCK_SECTOR_SIZE);
-  block_read (fs_device, block->doubly_indirect, doubly);
-  struct indirect_inode* indirect_block = calloc (1, BLOCK_SECTOR_SIZE);
-  block_read (fs_device, doubly->blocks[(index - 251) / 128], indirect_block);
-  block_sector_t result = indirect_block->blocks[(index - 251) % 128];
-  free (indirect_block);
-  free (doubly);
-  return result;
-}
+/* Slots of a block map.  Slot MAP_INDIRECT caches the singly
+   indirect block, MAP_DOUBLY the doubly indirect block, and
+   MAP_CHILD(I) the I'th child of the doubly indirect block. */
+#define MAP_INDIRECT 0
+#define MAP_DOUBLY 1
+#define MAP_CHILD(I) (2 + (I))
+#define MAP_SLOTS MAP_CHILD (128)
 
+/* In-memory copies of an inode's index blocks, read in lazily as
+   file blocks are looked up, so that once they are warm
+   byte_to_sector() does no I/O and no allocation.  A slot whose
+   LOADED flag is clear is stale and is re-read before its next
+   use, but its buffer stays allocated until the inode is freed:
+   growing a file only appends pointers, so a lookup racing with
+   the refresh still sees the value it needs. */
+struct block_map
+  {
+    struct indirect_inode *blocks[MAP_SLOTS];
+    bool loaded[MAP_SLOTS];
+  };
 
 /* Returns the number of sectors to allocate for an inode SIZE
    bytes long. */
@@ -70,15 +108,29 @@ bytes_to_sectors (off_t size)
 /* In-memory inode. */
 struct inode
   {
-    struct list_elem elem;              /* Element in inode list. */
+    struct hash_elem elem;              /* Element in open_inodes. */
     block_sector_t sector;              /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
     struct inode_disk data;             /* Inode content. */
     struct lock inode_lock;             /* Lock to protect metadata */
+    struct rwlock rw;                   /* Shared for I/O, exclusive
+                                           for growth. */
+    struct block_map *map;              /* Cached index blocks, or null. */
+    struct lock map_lock;               /* Serializes filling MAP. */
   };
 
+static block_sector_t inode_block_sector (struct inode *, size_t index);
+static block_sector_t extent_lookup (const struct inode_disk *, size_t index);
+static size_t extent_blocks (const struct inode_disk *);
+static size_t indexed_blocks (const struct inode_disk *);
+static void block_map_invalidate (struct inode *);
+static void block_map_free (struct inode *);
+
+/* A sector's worth of zeros, for clearing sectors. */
+static const char zeros[BLOCK_SECTOR_SIZE];
+
 bool 
 inode_is_dir (struct inode *node)
 {
@@ -90,127 +142,521 @@ inode_is_dir (struct inode *node)
    Returns -1 if INODE does not contain data for a byte at offset
    POS. */
 static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos)
+byte_to_sector (struct inode *inode, off_t pos)
 {
   ASSERT (inode != NULL);
   if (pos < inode->data.length)
+    return inode_block_sector (inode, pos / BLOCK_SECTOR_SIZE);
+  else
+    return -1;
+}
+
+/* Returns entry IDX of the index block in SECTOR, which INODE's
+   block map caches in slot SLOT.  Loads the slot if it is empty
+   or stale.  If memory for the map cannot be allocated, reads
+   just the one entry through the buffer cache instead. */
+static block_sector_t
+map_lookup (struct inode *inode, int slot, block_sector_t sector, size_t idx)
+{
+  struct block_map *map = inode->map;
+
+  if (map == NULL || !map->loaded[slot])
     {
-      block_sector_t block_sector = get_block_sector(pos / BLOCK_SECTOR_SIZE, &inode->data);
-      return block_sector;
+      lock_acquire (&inode->map_lock);
+      if (inode->map == NULL)
+        inode->map = calloc (1, sizeof *inode->map);
+      map = inode->map;
+      if (map != NULL && !map->loaded[slot])
+        {
+          if (map->blocks[slot] == NULL)
+            map->blocks[slot] = malloc (sizeof (struct indirect_inode));
+          if (map->blocks[slot] != NULL)
+            {
+              cache_read (sector, map->blocks[slot]);
+              map->loaded[slot] = true;
+            }
+        }
+      lock_release (&inode->map_lock);
+
+      if (map == NULL || !map->loaded[slot])
+        {
+          block_sector_t result;
+          cache_read_at (sector, &result, sizeof result, idx * sizeof result);
+          return result;
+        }
+    }
+  return map->blocks[slot]->blocks[idx];
+}
+
+/* Returns the sector that holds block INDEX of INODE's data, or
+   0 if the block is a hole.  (Sector 0 holds the free map's
+   inode, so it is never a data sector.)  A hole may be a null
+   pointer in an index block or a null pointer to the index block
+   itself. */
+static block_sector_t
+inode_block_sector (struct inode *inode, size_t index)
+{
+  if (inode->data.format == INODE_EXTENTS)
+    return extent_lookup (&inode->data, index);
+  else if (index < 123)
+    return inode->data.direct[index];
+  else if (index < 251)
+    {
+      if (inode->data.indirect == 0)
+        return 0;
+      return map_lookup (inode, MAP_INDIRECT, inode->data.indirect,
+                         index - 123);
+    }
+  else if (index < INDEXED_MAX_BLOCKS)
+    {
+      size_t l1_index = (index - 251) / 128;
+      size_t l2_index = (index - 251) % 128;
+      block_sector_t child;
+
+      if (inode->data.doubly_indirect == 0)
+        return 0;
+      child = map_lookup (inode, MAP_DOUBLY, inode->data.doubly_indirect,
+                          l1_index);
+      if (child == 0)
+        return 0;
+      return map_lookup (inode, MAP_CHILD (l1_index), child, l2_index);
     }
   else
-    return -1;
+    return 0;
+}
+
+/* Returns the sector that holds block INDEX of extent-format
+   DISK_INODE, or 0 if no extent covers it. */
+static block_sector_t
+extent_lookup (const struct inode_disk *disk_inode, size_t index)
+{
+  uint32_t i;
+
+  for (i = 0; i < disk_inode->extent_cnt; i++)
+    {
+      const struct extent *x = &disk_inode->extents[i];
+      if (index >= x->block && index - x->block < x->length)
+        return x->start + (index - x->block);
+    }
+  return 0;
+}
+
+/* Returns the number of file blocks that extent-format
+   DISK_INODE has sectors for. */
+static size_t
+extent_blocks (const struct inode_disk *disk_inode)
+{
+  const struct extent *last;
+
+  if (disk_inode->extent_cnt == 0)
+    return 0;
+  last = &disk_inode->extents[disk_inode->extent_cnt - 1];
+  return last->block + last->length;
+}
+
+/* Returns an upper bound on the file blocks that indexed-format
+   DISK_INODE has sectors for, which may lie past its length if
+   they were reserved by inode_reserve(). */
+static size_t
+indexed_blocks (const struct inode_disk *disk_inode)
+{
+  if (disk_inode->doubly_indirect != 0)
+    return INDEXED_MAX_BLOCKS;
+  else if (disk_inode->indirect != 0)
+    return 123 + 128;
+  else
+    return 123;
+}
+
+/* Marks every index block cached for INODE as stale, after the
+   file has grown and its index blocks have been rewritten. */
+static void
+block_map_invalidate (struct inode *inode)
+{
+  lock_acquire (&inode->map_lock);
+  if (inode->map != NULL)
+    memset (inode->map->loaded, 0, sizeof inode->map->loaded);
+  lock_release (&inode->map_lock);
+}
+
+/* Frees INODE's block map. */
+static void
+block_map_free (struct inode *inode)
+{
+  if (inode->map != NULL)
+    {
+      int i;
+      for (i = 0; i < MAP_SLOTS; i++)
+        free (inode->map->blocks[i]);
+      free (inode->map);
+      inode->map = NULL;
+    }
 }
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/* Open inodes, hashed by sector, so that opening a single inode
+   twice returns the same `struct inode'. */
+static struct hash open_inodes;
 static struct lock open_inodes_lock;
 
+static hash_hash_func inode_hash;
+static hash_less_func inode_less;
+
 /* Initializes the inode module. */
 void
 inode_init (void)
 {
-  list_init (&open_inodes);
+  if (!hash_init (&open_inodes, inode_hash, inode_less, NULL))
+    PANIC ("cannot allocate open inode table");
   lock_init (&open_inodes_lock);
 }
 
-/*
-  extends a file num_blocks of zeros from start_block for the disk_inode
-  which will be updated at block_sector_t sector.
-*/
-bool
-inode_extend (size_t start_block, size_t num_blocks, struct inode_disk* disk_inode, block_sector_t sector) {
-  if (num_blocks == 0) {
-    return true;
-  }
-  // writing zeros
-  struct indirect_inode* indirect = NULL;
-  struct indirect_inode* doubly = NULL;
-  struct indirect_inode* doubly_children[128];
-  memset (doubly_children, 0, sizeof (doubly_children));
-  static char zeros[BLOCK_SECTOR_SIZE];
+/* Returns a hash value for the inode that E is embedded in. */
+static unsigned
+inode_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct inode, elem)->sector);
+}
+
+/* Returns true if inode A precedes inode B. */
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct inode, elem)->sector
+          < hash_entry (b, struct inode, elem)->sector);
+}
+
+/* Prints statistics about the open inode table. */
+void
+inode_print_stats (void)
+{
+  size_t used = 0, longest = 0;
   size_t i;
-  for(i = start_block; i < num_blocks + start_block; i++)
-    {
-      if (i < 123) // direct
-        if (free_map_allocate (1, &disk_inode->direct[i]))
-          block_write (fs_device, disk_inode->direct[i], zeros);
-        else 
-          return false;
-      else if (i < 251) // singly indirect
+
+  lock_acquire (&open_inodes_lock);
+  for (i = 0; i < open_inodes.bucket_cnt; i++)
+    {
+      size_t len = list_size (&open_inodes.buckets[i]);
+      if (len > 0)
+        used++;
+      if (len > longest)
+        longest = len;
+    }
+  printf ("Inodes: %zu open, %zu of %zu buckets in use, "
+          "longest chain %zu\n",
+          hash_size (&open_inodes), used, open_inodes.bucket_cnt, longest);
+  lock_release (&open_inodes_lock);
+}
+
+static size_t indexed_fill (struct inode_disk *, size_t block, size_t cnt);
+static size_t extents_fill (struct inode_disk *, size_t block, size_t cnt);
+static bool indexed_set (struct inode_disk *, size_t index,
+                         block_sector_t sector);
+static bool extents_to_indexed (struct inode_disk *);
+static void release_index_blocks (const struct inode_disk *);
+static size_t fill_hole_update (struct inode *, size_t block, size_t cnt);
+
+/* Returns the number of consecutive holes in INODE starting at
+   file block BLOCK, up to MAX. */
+static size_t
+hole_size (struct inode *inode, size_t block, size_t max)
+{
+  size_t cnt;
+
+  for (cnt = 0; cnt < max; cnt++)
+    if (inode_block_sector (inode, block + cnt) != 0)
+      break;
+  return cnt;
+}
+
+/* Allocates sectors for file blocks BLOCK through BLOCK + CNT - 1
+   of INODE, all of which must be holes, and writes INODE's
+   on-disk inode, all as one journal update.  The new sectors are
+   not written, so the caller must write each of them in full
+   before it can be read.  Returns the number of blocks
+   allocated, counting from BLOCK, which is 0 if the disk is full
+   or the file cannot grow that far and never more than
+   FILL_MAX_BLOCKS.  INODE's RW lock must be held for writing. */
+static size_t
+inode_fill_hole (struct inode *inode, size_t block, size_t cnt)
+{
+  size_t filled;
+
+  ASSERT (rwlock_held_for_write (&inode->rw));
+
+  if (cnt > FILL_MAX_BLOCKS)
+    cnt = FILL_MAX_BLOCKS;
+  filled = fill_hole_update (inode, block, cnt);
+
+  /* The free map reclaims sectors released since the last journal
+     checkpoint when it runs out, but it cannot do so inside the
+     update, so give it a chance now that the update is over. */
+  if (filled == 0 && free_map_has_deferred () && journal_checkpoint ())
+    filled = fill_hole_update (inode, block, cnt);
+  return filled;
+}
+
+/* Does the work of inode_fill_hole() as one journal update. */
+static size_t
+fill_hole_update (struct inode *inode, size_t block, size_t cnt)
+{
+  struct inode_disk *disk_inode = &inode->data;
+  bool converted = false;
+  size_t filled = 0;
+
+  journal_begin ();
+  if (disk_inode->format == INODE_EXTENTS)
+    {
+      filled = extents_fill (disk_inode, block, cnt);
+
+      /* Too fragmented for the extent table: switch to the
+         indexed layout and allocate through it. */
+      if (filled == 0 && disk_inode->extent_cnt == EXTENT_CNT)
+        converted = extents_to_indexed (disk_inode);
+    }
+  if (disk_inode->format == INODE_INDEXED && filled == 0)
+    filled = indexed_fill (disk_inode, block, cnt);
+
+  if (filled > 0 || converted)
+    {
+      cache_write (inode->sector, disk_inode);
+      block_map_invalidate (inode);
+
+      /* The free map file is only grown by free_map_create(),
+         whose write picks up the bits just set for its own
+         sectors, and flushing here would write it recursively. */
+      if (inode->sector != FREE_MAP_SECTOR)
+        free_map_flush ();
+    }
+  journal_end ();
+  return filled;
+}
+
+/* Allocates sectors for holes BLOCK through BLOCK + CNT - 1 of
+   indexed-format DISK_INODE, as one contiguous run if possible,
+   along with any index blocks they need.  Does not write
+   DISK_INODE.  Returns the number of blocks allocated, counting
+   from BLOCK. */
+static size_t
+indexed_fill (struct inode_disk *disk_inode, size_t block, size_t cnt)
+{
+  block_sector_t sector;
+  size_t i;
+
+  if (block >= INDEXED_MAX_BLOCKS)
+    return 0;
+  if (cnt > INDEXED_MAX_BLOCKS - block)
+    cnt = INDEXED_MAX_BLOCKS - block;
+
+  cnt = free_map_allocate_run (cnt, &sector);
+  for (i = 0; i < cnt; i++)
+    if (!indexed_set (disk_inode, block + i, sector + i))
+      {
+        free_map_release (sector + i, cnt - i);
+        return i;
+      }
+  return cnt;
+}
+
+/* Allocates sectors for holes BLOCK through BLOCK + CNT - 1 of
+   extent-format DISK_INODE.  Grows the extent that ends at BLOCK
+   in place when the sectors after it are free, and otherwise
+   allocates the longest contiguous run available as a new
+   extent.  Does not write DISK_INODE.  Returns the number of
+   blocks allocated, counting from BLOCK, which is 0 if the disk
+   or the extent table is full. */
+static size_t
+extents_fill (struct inode_disk *disk_inode, size_t block, size_t cnt)
+{
+  struct extent *x = disk_inode->extents;
+  block_sector_t sector;
+  size_t pos, got;
+
+  /* Find where an extent starting at BLOCK belongs. */
+  for (pos = 0; pos < disk_inode->extent_cnt; pos++)
+    if (x[pos].block > block)
+      break;
+
+  if (pos > 0 && x[pos - 1].block + x[pos - 1].length == block)
+    {
+      got = free_map_allocate_at (x[pos - 1].start + x[pos - 1].length, cnt);
+      x[pos - 1].length += got;
+      if (got > 0)
+        return got;
+    }
+
+  if (disk_inode->extent_cnt == EXTENT_CNT)
+    return 0;
+  got = free_map_allocate_run (cnt, &sector);
+  if (got == 0)
+    return 0;
+  memmove (&x[pos + 1], &x[pos], (disk_inode->extent_cnt - pos) * sizeof *x);
+  x[pos].block = block;
+  x[pos].start = sector;
+  x[pos].length = got;
+  disk_inode->extent_cnt++;
+  return got;
+}
+
+/* Sets file block INDEX of indexed-format DISK_INODE to SECTOR,
+   allocating index blocks as needed.  Returns false if an index
+   block cannot be allocated. */
+static bool
+indexed_set (struct inode_disk *disk_inode, size_t index,
+             block_sector_t sector)
+{
+  block_sector_t *ptr;
+  size_t idx;
+
+  if (index < 123)
+    {
+      disk_inode->direct[index] = sector;
+      return true;
+    }
+  else if (index < 251)
+    {
+      ptr = &disk_inode->indirect;
+      idx = index - 123;
+    }
+  else
+    {
+      /* Find or make the second-level index block, then set the
+         pointer in it. */
+      size_t l1_index = (index - 251) / 128;
+      block_sector_t child;
+      if (disk_inode->doubly_indirect == 0)
         {
-          if (indirect == NULL) 
-            {
-              //single indirect block NOT ZEROS but sector nums
-              indirect = calloc (1, sizeof (struct indirect_inode));
-              if (disk_inode->indirect != NULL)
-                block_read (fs_device, disk_inode->indirect, indirect);
-              else if (!free_map_allocate (1, &disk_inode->indirect))
-                return false;
-            }
-          if (free_map_allocate (1, &indirect->blocks[i - 123]))
-            block_write (fs_device, indirect->blocks[i - 123], zeros);
-          else
+          if (!free_map_allocate (1, &disk_inode->doubly_indirect))
             return false;
-        } 
-      else 
+          cache_write (disk_inode->doubly_indirect, zeros);
+        }
+      cache_read_at (disk_inode->doubly_indirect, &child, sizeof child,
+                     l1_index * sizeof child);
+      if (child == 0)
         {
-          if (doubly == NULL) 
-            {
-              //doubly indirect block NOT ZEROS but sector nums
-              doubly = calloc (1, sizeof(struct indirect_inode));
-              if (disk_inode->doubly_indirect != NULL) 
-                block_read (fs_device, disk_inode->doubly_indirect, doubly);
-              else if (!free_map_allocate (1, &disk_inode->doubly_indirect))
-                return false;
-            }
-          int l1_index = (i - 251) / 128;
-          int l2_index = (i - 251) % 128;
-          if (doubly_children[l1_index] == NULL) 
-            {
-              //doubly indirect child block NOT ZEROS but sector nums
-              doubly_children[l1_index] = calloc (1, sizeof(struct indirect_inode));
-              if (doubly->blocks[l1_index] != NULL)
-                block_read (fs_device, doubly->blocks[l1_index], doubly_children[l1_index]);
-              else if (!free_map_allocate (1, &doubly->blocks[l1_index]))
-                return false;
-            }
-          if (free_map_allocate (1, &doubly_children[l1_index]->blocks[l2_index]))
-            block_write (fs_device, doubly_children[l1_index]->blocks[l2_index], zeros);
-          else 
+          if (!free_map_allocate (1, &child))
             return false;
+          cache_write (child, zeros);
+          cache_write_at (disk_inode->doubly_indirect, &child, sizeof child,
+                          l1_index * sizeof child);
         }
+      cache_write_at (child, &sector, sizeof sector,
+                      (index - 251) % 128 * sizeof sector);
+      return true;
     }
-  // write indirect blocks
-  if (indirect != NULL) 
+
+  if (*ptr == 0)
     {
-      block_write (fs_device, disk_inode->indirect, indirect);
-      free (indirect);
+      if (!free_map_allocate (1, ptr))
+        return false;
+      cache_write (*ptr, zeros);
     }
-  if (doubly != NULL) 
+  cache_write_at (*ptr, &sector, sizeof sector, idx * sizeof sector);
+  return true;
+}
+
+/* Fills INDEX with the sectors of file blocks FIRST through
+   FIRST + 127 of extent-format DISK_INODE, which has BLOCKS
+   blocks, and if any of them is allocated writes INDEX to a newly
+   allocated index block and stores its sector in *SECTORP.  Holes
+   past BLOCKS are left as holes.  The index block is written
+   straight to disk, so it is in place before the inode that
+   points to it commits.  Returns false if the index block cannot
+   be allocated. */
+static bool
+write_index_block (const struct inode_disk *disk_inode, size_t first,
+                   size_t blocks, struct indirect_inode *index,
+                   block_sector_t *sectorp)
+{
+  bool used = false;
+  size_t i;
+
+  for (i = 0; i < 128; i++)
     {
-      block_write (fs_device, disk_inode->doubly_indirect, doubly);
-      size_t i;
-      int start = (start_block < 251) ? 0 : (start_block - 251) / 128;
-      for (i = start; i < ((start_block + num_blocks - 251 - 1) / 128) + 1; i++)
-        {
-          block_write (fs_device, doubly->blocks[i], doubly_children[i]);
-          free (doubly_children[i]);
-        }
-      free(doubly);
+      index->blocks[i] = (first + i < blocks
+                          ? extent_lookup (disk_inode, first + i) : 0);
+      if (index->blocks[i] != 0)
+        used = true;
     }
-  // writing inode
-  block_write (fs_device, sector, disk_inode);
+  if (!used)
+    return true;
+  if (!free_map_allocate (1, sectorp))
+    return false;
+  cache_write_through (*sectorp, index);
   return true;
+}
+
+/* Converts extent-format DISK_INODE to the indexed format,
+   keeping its data where it is.  Returns false if the file is
+   too big for the indexed format or an index block cannot be
+   allocated, in which case DISK_INODE is unchanged and any index
+   blocks already allocated are released.
+
+   The new index blocks are written outside the journal, straight
+   to disk, since a big file needs more of them than one journal
+   update may modify.  That is safe because nothing on disk refers
+   to them until DISK_INODE is written in the new format. */
+static bool
+extents_to_indexed (struct inode_disk *disk_inode)
+{
+  struct inode_disk *indexed;
+  struct indirect_inode *index, *doubly;
+  size_t blocks = extent_blocks (disk_inode);
+  bool success = false;
+  size_t i;
+
+  if (blocks > INDEXED_MAX_BLOCKS)
+    return false;
+  indexed = calloc (1, sizeof *indexed);
+  index = malloc (sizeof *index);
+  doubly = calloc (1, sizeof *doubly);
+  if (indexed == NULL || index == NULL || doubly == NULL)
+    goto done;
+
+  indexed->length = disk_inode->length;
+  indexed->is_dir = disk_inode->is_dir;
+  indexed->format = INODE_INDEXED;
+  indexed->magic = disk_inode->magic;
+  for (i = 0; i < 123 && i < blocks; i++)
+    indexed->direct[i] = extent_lookup (disk_inode, i);
+  if (blocks > 123
+      && !write_index_block (disk_inode, 123, blocks, index,
+                             &indexed->indirect))
+    goto fail;
+  for (i = 251; i < blocks; i += 128)
+    if (!write_index_block (disk_inode, i, blocks, index,
+                            &doubly->blocks[(i - 251) / 128]))
+      goto fail;
+  if (blocks > 251)
+    {
+      if (!free_map_allocate (1, &indexed->doubly_indirect))
+        goto fail;
+      cache_write_through (indexed->doubly_indirect, doubly);
+    }
 
+  memcpy (disk_inode, indexed, sizeof *disk_inode);
+  success = true;
+  goto done;
+
+ fail:
+  if (indexed->indirect != 0)
+    free_map_release (indexed->indirect, 1);
+  for (i = 0; i < 128; i++)
+    if (doubly->blocks[i] != 0)
+      free_map_release (doubly->blocks[i], 1);
+ done:
+  free (indexed);
+  free (index);
+  free (doubly);
+  return success;
 }
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   device.
+   device.  The data is all one hole: no sectors are allocated
+   for it until it is written.
    Returns true if successful.
-   Returns false if memory or disk allocation fails. */
+   Returns false if memory allocation fails. */
 bool
 inode_create (block_sector_t sector, off_t length)
 {
@@ -225,12 +671,18 @@ inode_create (block_sector_t sector, off_t length)
   disk_inode = calloc (1, sizeof *disk_inode);
   if (disk_inode != NULL)
     {
-      size_t sectors = (length) ? bytes_to_sectors (length) : 1;
       disk_inode->length = length;
+      disk_inode->format = INODE_EXTENTS;
       disk_inode->magic = INODE_MAGIC;
-      bool result = inode_extend (0, sectors, disk_inode, sector);
+
+      /* Commit the caller's allocation of SECTOR along with the
+         inode, so that neither reaches disk without the other. */
+      journal_begin ();
+      cache_write (sector, disk_inode);
+      free_map_flush ();
+      journal_end ();
       free (disk_inode);
-      return result;
+      return true;
     }
   
   return false;
@@ -242,40 +694,48 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
+  struct hash_elem *e;
+  struct inode key;
   struct inode *inode;
 
   /* Check whether this inode is already open. */
+  key.sector = sector;
   lock_acquire (&open_inodes_lock);
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e))
+  e = hash_find (&open_inodes, &key.elem);
+  if (e != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector)
-        {
-          inode_reopen (inode);
-          lock_release (&open_inodes_lock);
-          return inode;
-        }
+      inode = inode_reopen (hash_entry (e, struct inode, elem));
+      lock_release (&open_inodes_lock);
+      return inode;
     }
+  lock_release (&open_inodes_lock);
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-  {
-    lock_release (&open_inodes_lock);
     return NULL;
-  }
 
   /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
-  lock_release (&open_inodes_lock);
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
   lock_init (&inode->inode_lock);
-  block_read (fs_device, inode->sector, &inode->data);
+  rwlock_init (&inode->rw);
+  inode->map = NULL;
+  lock_init (&inode->map_lock);
+  cache_read (inode->sector, &inode->data);
+
+  /* Publish it, unless another thread opened the same inode
+     while we were reading it. */
+  lock_acquire (&open_inodes_lock);
+  e = hash_insert (&open_inodes, &inode->elem);
+  if (e != NULL)
+    {
+      free (inode);
+      inode = inode_reopen (hash_entry (e, struct inode, elem));
+    }
+  lock_release (&open_inodes_lock);
   return inode;
 }
 
@@ -307,14 +767,16 @@ inode_close (struct inode *inode)
   if (inode == NULL)
     return;
 
+  /* Hold open_inodes_lock across the decrement so that
+     inode_open() cannot find an inode that is being freed. */
+  lock_acquire (&open_inodes_lock);
   lock_acquire (&inode->inode_lock);
 
   /* Release resources if this was the last opener. */
   if (--inode->open_cnt == 0)
     {
-      /* Remove from inode list and release lock. */
-      lock_acquire (&open_inodes_lock);
-      list_remove (&inode->elem);
+      /* Remove from the open inode table and release lock. */
+      hash_delete (&open_inodes, &inode->elem);
       lock_release (&open_inodes_lock);
 
       /* Deallocate blocks if removed. */
@@ -322,18 +784,54 @@ inode_close (struct inode *inode)
         {
           free_map_release (inode->sector, 1);
           size_t i;
-          for(i = 0; i < bytes_to_sectors(inode->data.length); i++)
+          if (inode->data.format == INODE_EXTENTS)
+            for (i = 0; i < inode->data.extent_cnt; i++)
+              free_map_release (inode->data.extents[i].start,
+                                inode->data.extents[i].length);
+          else
             {
-              free_map_release (get_block_sector(i, &inode->data), 1);
+              for (i = 0; i < indexed_blocks (&inode->data); i++)
+                {
+                  block_sector_t s = inode_block_sector (inode, i);
+                  if (s != 0)
+                    free_map_release (s, 1);
+                }
+              release_index_blocks (&inode->data);
             }
           // free_map_release (inode->data.start,
           //                   bytes_to_sectors (inode->data.length));
+          free_map_flush ();
         }
       lock_release (&inode->inode_lock);
+      block_map_free (inode);
       free (inode);
     }
   else
+    {
       lock_release (&inode->inode_lock);
+      lock_release (&open_inodes_lock);
+    }
+}
+
+/* Releases the index blocks of indexed-format DISK_INODE. */
+static void
+release_index_blocks (const struct inode_disk *disk_inode)
+{
+  if (disk_inode->indirect != 0)
+    free_map_release (disk_inode->indirect, 1);
+  if (disk_inode->doubly_indirect != 0)
+    {
+      size_t i;
+      for (i = 0; i < 128; i++)
+        {
+          block_sector_t child;
+          cache_read_at (disk_inode->doubly_indirect, &child, sizeof child,
+                         i * sizeof child);
+          if (child != 0)
+            free_map_release (child, 1);
+        }
+      free_map_release (disk_inode->doubly_indirect, 1);
+    }
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -353,7 +851,8 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
+
+  rwlock_acquire_read (&inode->rw);
   while (size > 0)
     {
       /* Disk sector to read, starting byte offset within sector. */
@@ -370,47 +869,173 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
-        }
+      /* Copy the chunk out of the buffer cache.  Holes read as
+         zeros. */
+      if (sector_idx != 0)
+        cache_read_at (sector_idx, buffer + bytes_read, chunk_size,
+                       sector_ofs);
       else
-        {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL)
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          block_read (fs_device, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-        }
+        memset (buffer + bytes_read, 0, chunk_size);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
+  rwlock_release_read (&inode->rw);
 
   return bytes_read;
 }
 
+/* Queues the sectors holding the SIZE bytes of INODE starting at
+   OFFSET to be read into the buffer cache in the background.
+   Bytes past end of file and holes are ignored.  Returns false if the
+   read-ahead queue filled up before every sector was queued. */
+bool
+inode_read_ahead (struct inode *inode, off_t offset, off_t size)
+{
+  off_t end = offset + size;
+  bool success = true;
+
+  rwlock_acquire_read (&inode->rw);
+  if (end > inode_length (inode))
+    end = inode_length (inode);
+  for (offset -= offset % BLOCK_SECTOR_SIZE; offset < end && success;
+       offset += BLOCK_SECTOR_SIZE)
+    {
+      block_sector_t sector = byte_to_sector (inode, offset);
+      if (sector != 0 && !cache_read_ahead (sector))
+        success = false;
+    }
+  rwlock_release_read (&inode->rw);
+  return success;
+}
+
+/* Zeroes bytes START through END - 1 of INODE wherever sectors
+   are allocated for them, leaving holes alone.  INODE's RW lock
+   must be held for writing, since the bytes lie past the end of
+   file. */
+static void
+zero_range (struct inode *inode, off_t start, off_t end)
+{
+  ASSERT (rwlock_held_for_write (&inode->rw));
+
+  while (start < end)
+    {
+      block_sector_t sector = inode_block_sector (inode,
+                                                  start / BLOCK_SECTOR_SIZE);
+      int sector_ofs = start % BLOCK_SECTOR_SIZE;
+      int chunk_size = BLOCK_SECTOR_SIZE - sector_ofs;
+
+      if (chunk_size > end - start)
+        chunk_size = end - start;
+      if (sector != 0)
+        cache_write_at (sector, zeros, chunk_size, sector_ofs);
+      start += chunk_size;
+    }
+}
+
+/* Allocates sectors for the holes in the SIZE bytes of INODE
+   starting at OFFSET, in as few contiguous runs as the free map
+   allows, without changing INODE's length, so that later writes
+   there do no allocation.  Newly allocated sectors below the end
+   of file are zeroed, since they become readable at once; those
+   past it are left as they are until a write reaches them.
+   Returns true if successful, false if writes to INODE are
+   denied or if the disk fills up or the file cannot grow that
+   far, in which case some of the range may have been
+   allocated. */
+bool
+inode_reserve (struct inode *inode, off_t offset, off_t size)
+{
+  size_t block, last;
+  bool success = true;
+
+  ASSERT (offset >= 0 && size >= 0);
+
+  lock_acquire (&inode->inode_lock);
+  if (inode->deny_write_cnt)
+    {
+      lock_release (&inode->inode_lock);
+      return false;
+    }
+  lock_release (&inode->inode_lock);
+  if (size == 0)
+    return true;
+
+  rwlock_acquire_write (&inode->rw);
+  block = offset / BLOCK_SECTOR_SIZE;
+  last = (offset + size - 1) / BLOCK_SECTOR_SIZE;
+  while (block <= last)
+    {
+      size_t cnt, i;
+
+      if (inode_block_sector (inode, block) != 0)
+        {
+          block++;
+          continue;
+        }
+
+      cnt = hole_size (inode, block, last - block + 1);
+      cnt = inode_fill_hole (inode, block, cnt);
+      if (cnt == 0)
+        {
+          success = false;
+          break;
+        }
+      for (i = 0; i < cnt; i++)
+        if ((off_t) ((block + i) * BLOCK_SECTOR_SIZE) < inode_length (inode))
+          cache_write (inode_block_sector (inode, block + i), zeros);
+      block += cnt;
+    }
+  rwlock_release_write (&inode->rw);
+  return success;
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the disk fills up or an error occurs.
+   Writing past end of file extends the inode, leaving a hole
+   between the old end of file and OFFSET.  Sectors are allocated
+   for holes as they are written. */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
                 off_t offset)
 {
-  const uint8_t *buffer = buffer_;
+  struct iovec iov;
+
+  iov.iov_base = (void *) buffer;
+  iov.iov_len = size;
+  return inode_writev (inode, &iov, 1, offset);
+}
+
+/* Writes the IOV_CNT buffers in IOV into INODE one after
+   another, starting at OFFSET, as a single write: holes in the
+   whole range are filled together and the length is updated
+   once.  The total size must not exceed the largest off_t.
+   Returns the number of bytes actually written, as
+   inode_write_at() does.
+
+   A write that stays within the file's allocated sectors holds
+   INODE's reader-writer lock for reading, so it runs alongside
+   reads and other such writes; the buffer cache keeps each
+   sector consistent.  Only a write that fills a hole or extends
+   the file holds the lock for writing. */
+off_t
+inode_writev (struct inode *inode, const struct iovec *iov, int iov_cnt,
+              off_t offset)
+{
+  off_t size = 0;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
+  size_t seg_ofs = 0;
+  size_t fresh_start = 0, fresh_end = 0;
+  size_t zeroed = SIZE_MAX;
+  bool exclusive;
+  int i;
+
+  for (i = 0; i < iov_cnt; i++)
+    size += iov[i].iov_len;
+
   lock_acquire (&inode->inode_lock);
   if (inode->deny_write_cnt)
     {
@@ -418,69 +1043,207 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       return 0;
     }
   lock_release (&inode->inode_lock);
-  size_t write_blocks = bytes_to_sectors(offset + size);
-  size_t current_blocks = bytes_to_sectors(inode_length(inode));
-  
-  if (write_blocks > current_blocks) {
-    size_t length = write_blocks - current_blocks;
-    inode_extend (current_blocks, length, &inode->data, inode->sector);
-  }
-  if (offset + size > inode_length(inode)) {
-    inode->data.length = offset + size;
-    block_write (fs_device, inode->sector, &inode->data);
-  }
+
+  /* The file only grows, so a write that starts out within it
+     stays within it. */
+  exclusive = offset + size > inode_length (inode);
+  if (exclusive)
+    rwlock_acquire_write (&inode->rw);
+  else
+    rwlock_acquire_read (&inode->rw);
+
+  /* Sectors reserved past end of file by inode_reserve() hold
+     garbage, so zero any part of them that this write leaves
+     between the old end of file and OFFSET. */
+  if (size > 0 && offset > inode_length (inode))
+    zero_range (inode, inode_length (inode), offset);
+
   while (size > 0)
     {
-      /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Block to write, starting byte offset within sector. */
+      size_t block = offset / BLOCK_SECTOR_SIZE;
+      block_sector_t sector_idx = inode_block_sector (inode, block);
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      /* Number of bytes to actually write into this sector: no
+         more than is left in the sector or the current buffer. */
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
+      int chunk_size = size < sector_left ? size : sector_left;
 
-      /* Number of bytes to actually write into this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
-        break;
+      if (seg_ofs == iov->iov_len)
+        {
+          iov++;
+          seg_ofs = 0;
+          continue;
+        }
+      if ((size_t) chunk_size > iov->iov_len - seg_ofs)
+        chunk_size = iov->iov_len - seg_ofs;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      /* Allocate sectors for the hole we are writing into, as far
+         as this write and the hole extend.  Blocks FRESH_START
+         through FRESH_END - 1 are newly allocated and so hold
+         garbage until written. */
+      if (sector_idx == 0 && !exclusive)
         {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
+          /* Take the lock for writing and look again, since the
+             hole may have been filled while we waited. */
+          rwlock_release_read (&inode->rw);
+          rwlock_acquire_write (&inode->rw);
+          exclusive = true;
+          continue;
         }
-      else
+      if (sector_idx == 0)
         {
-          /* We need a bounce buffer. */
-          if (bounce == NULL)
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
+          size_t last = (offset + size - 1) / BLOCK_SECTOR_SIZE;
+          size_t cnt = hole_size (inode, block, last - block + 1);
 
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left)
-            block_read (fs_device, sector_idx, bounce);
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
+          cnt = inode_fill_hole (inode, block, cnt);
+          if (cnt == 0)
+            break;
+          fresh_start = block;
+          fresh_end = block + cnt;
+          sector_idx = inode_block_sector (inode, block);
+        }
+
+      /* A fresh sector that is not written in one piece is zeroed
+         before its first piece, since the cache reads in the rest
+         of a sector for a partial write. */
+      if (block >= fresh_start && block < fresh_end
+          && chunk_size < BLOCK_SECTOR_SIZE && block != zeroed)
+        {
+          cache_write (sector_idx, zeros);
+          zeroed = block;
         }
 
+      /* Copy the chunk into the buffer cache, which reads in the
+         rest of the sector first if the chunk is partial. */
+      cache_write_at (sector_idx, (const uint8_t *) iov->iov_base + seg_ofs,
+                      chunk_size, sector_ofs);
+
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_written += chunk_size;
+      seg_ofs += chunk_size;
     }
-  free (bounce);
 
+  if (bytes_written > 0 && offset > inode_length (inode))
+    {
+      inode->data.length = offset;
+      journal_begin ();
+      cache_write (inode->sector, &inode->data);
+      journal_end ();
+    }
+
+  if (exclusive)
+    rwlock_release_write (&inode->rw);
+  else
+    rwlock_release_read (&inode->rw);
   return bytes_written;
 }
 
+/* Maximum number of sectors that inode_copy_sectors() looks up
+   in SRC at a time. */
+#define COPY_BATCH 8
+
+/* Copies up to CNT whole sectors of SRC, starting at SRC_OFS, to
+   DST at DST_OFS, directly from one buffer cache entry to
+   another.  Both offsets must be sector-aligned, and the range
+   written in DST must already be allocated, as by
+   inode_reserve().  Extends DST if the copy runs past its end of
+   file.  Returns the number of bytes copied, which is short at
+   the end of SRC or an unallocated sector of DST, or 0 if writes
+   to DST are denied.
+
+   SRC's sectors are looked up a batch at a time before DST is
+   locked, so that the two inodes' locks are never held
+   together. */
+off_t
+inode_copy_sectors (struct inode *dst, off_t dst_ofs,
+                    struct inode *src, off_t src_ofs, size_t cnt)
+{
+  off_t bytes_copied = 0;
+
+  ASSERT (dst_ofs % BLOCK_SECTOR_SIZE == 0);
+  ASSERT (src_ofs % BLOCK_SECTOR_SIZE == 0);
+
+  lock_acquire (&dst->inode_lock);
+  if (dst->deny_write_cnt)
+    {
+      lock_release (&dst->inode_lock);
+      return 0;
+    }
+  lock_release (&dst->inode_lock);
+
+  while (cnt > 0)
+    {
+      block_sector_t sectors[COPY_BATCH];
+      size_t batch = cnt < COPY_BATCH ? cnt : COPY_BATCH;
+      size_t copied = 0;
+      bool exclusive;
+      off_t end;
+      size_t i;
+
+      rwlock_acquire_read (&src->rw);
+      for (i = 0; i < batch; i++)
+        {
+          off_t ofs = src_ofs + i * BLOCK_SECTOR_SIZE;
+          if (ofs + BLOCK_SECTOR_SIZE > inode_length (src))
+            break;
+          sectors[i] = byte_to_sector (src, ofs);
+        }
+      rwlock_release_read (&src->rw);
+      batch = i;
+      if (batch == 0)
+        break;
+
+      end = dst_ofs + batch * BLOCK_SECTOR_SIZE;
+      exclusive = end > inode_length (dst);
+      if (exclusive)
+        rwlock_acquire_write (&dst->rw);
+      else
+        rwlock_acquire_read (&dst->rw);
+
+      /* As in inode_writev(), reserved sectors between the old end
+         of file and DST_OFS hold garbage. */
+      if (dst_ofs > inode_length (dst))
+        zero_range (dst, inode_length (dst), dst_ofs);
+
+      for (; copied < batch; copied++)
+        {
+          block_sector_t sector
+            = inode_block_sector (dst, dst_ofs / BLOCK_SECTOR_SIZE + copied);
+          if (sector == 0)
+            break;
+          if (sectors[copied] != 0)
+            cache_copy (sector, sectors[copied]);
+          else
+            cache_write (sector, zeros);
+        }
+
+      end = dst_ofs + copied * BLOCK_SECTOR_SIZE;
+      if (end > inode_length (dst))
+        {
+          dst->data.length = end;
+          journal_begin ();
+          cache_write (dst->sector, &dst->data);
+          journal_end ();
+        }
+      if (exclusive)
+        rwlock_release_write (&dst->rw);
+      else
+        rwlock_release_read (&dst->rw);
+
+      dst_ofs += copied * BLOCK_SECTOR_SIZE;
+      src_ofs += copied * BLOCK_SECTOR_SIZE;
+      bytes_copied += copied * BLOCK_SECTOR_SIZE;
+      cnt -= copied;
+      if (copied < batch)
+        break;
+    }
+  return bytes_copied;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
@@ -516,7 +1279,7 @@ void
 set_dir (struct inode *inode)
 {
   inode->data.is_dir = true;
-  block_write (fs_device, inode->sector, &inode->data);
+  cache_write (inode->sector, &inode->data);
 }
 bool
 is_relative (char *path)
@@ -1,6 +1,7 @@
 #ifndef FILESYS_INODE_H
 #define FILESYS_INODE_H
 
+#include <iovec.h>
 #include <stdbool.h>
 #include "filesys/off_t.h"
 #include "devices/block.h"
@@ -16,6 +17,12 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_writev (struct inode *, const struct iovec *, int iov_cnt,
+                    off_t offset);
+bool inode_reserve (struct inode *, off_t offset, off_t size);
+off_t inode_copy_sectors (struct inode *dst, off_t dst_ofs,
+                          struct inode *src, off_t src_ofs, size_t cnt);
+bool inode_read_ahead (struct inode *, off_t offset, off_t size);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
@@ -25,4 +32,5 @@ struct inode* get_inode_from_path (char*);
 struct dir* get_parent_dir_from_path (char*);
 char* get_last_part(char*);
 bool inode_is_removed(struct inode *);
+void inode_print_stats (void);
 #endif /* filesys/inode.h */
@@ -0,0 +1,493 @@
+#include "filesys/journal.h"
+#include <debug.h>
+#include <hash.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Metadata journal.
+
+   Code that updates file system metadata brackets the update
+   with journal_begin() and journal_end().  Sectors written
+   through the buffer cache in between join the running
+   transaction, and the cache keeps them from reaching their home
+   locations until the transaction commits.  Once no updates are
+   in progress and the transaction holds JOURNAL_COMMIT_BLOCKS
+   sectors, or when the write-behind thread asks, the transaction
+   is committed by appending a descriptor listing its sectors,
+   their contents, and a commit record to the log, all in
+   sequence.  Committed sectors are then written home by the
+   buffer cache in its own time, and the log is reset once
+   everything it covers has been written home.
+
+   An update must never be split across transactions, and a
+   transaction cannot commit while an update is in progress, so
+   each update is assumed to modify at most JOURNAL_UPDATE_BLOCKS
+   sectors besides the free map.  An update only starts once the
+   running transaction has room for that many more sectors from
+   it and from every other update in progress; otherwise it waits
+   for them to finish and commit.
+
+   On startup the committed transactions found in the log are
+   copied to their home locations, in order, stopping at the
+   first one that is incomplete.
+
+   The journal covers metadata only.  File data is written in
+   place, so after a crash a file may contain stale data in
+   sectors allocated just before it. */
+
+/* Magic numbers. */
+#define SUPER_MAGIC 0x4a524e4c          /* "JRNL". */
+#define DESC_MAGIC 0x4a444553           /* "JDES". */
+#define COMMIT_MAGIC 0x4a434d54         /* "JCMT". */
+
+/* Maximum number of sectors in a transaction.  Kept well under
+   CACHE_SIZE, since the cache cannot evict sectors of the running
+   transaction. */
+#define JOURNAL_MAX_BLOCKS 56
+
+/* Maximum number of sectors other than free map sectors that one
+   update, including any updates nested inside it, may add to the
+   running transaction.  Growing a file allocates at most
+   FILL_MAX_BLOCKS blocks per update to stay within it. */
+#define JOURNAL_UPDATE_BLOCKS 16
+
+/* Size of the running transaction at which it is committed. */
+#define JOURNAL_COMMIT_BLOCKS 16
+
+/* Journal superblock, in sector JOURNAL_SECTOR. */
+struct journal_super
+  {
+    uint32_t magic;                     /* SUPER_MAGIC. */
+    block_sector_t start;               /* First sector of the log. */
+    uint32_t size;                      /* Number of sectors in the log. */
+    uint32_t seq;                       /* Sequence number of the
+                                           transaction at the start
+                                           of the log. */
+    uint8_t unused[496];
+  };
+
+/* Transaction descriptor, followed in the log by the contents of
+   CNT sectors and a commit record. */
+struct journal_desc
+  {
+    uint32_t magic;                     /* DESC_MAGIC. */
+    uint32_t seq;                       /* Transaction sequence number. */
+    uint32_t cnt;                       /* Number of sectors. */
+    block_sector_t sectors[125];        /* Home sectors, in log order. */
+  };
+
+/* Transaction commit record. */
+struct journal_commit
+  {
+    uint32_t magic;                     /* COMMIT_MAGIC. */
+    uint32_t seq;                       /* Transaction sequence number. */
+    uint32_t checksum;                  /* Of the logged contents. */
+    uint8_t unused[500];
+  };
+
+/* Journal state, protected by JOURNAL_LOCK.  A commit holds the
+   lock throughout, which keeps new updates from starting until it
+   is done.  Sectors join the running transaction with the cache
+   entry lock held, but only inside an update, so a commit, which
+   runs only when no updates are in progress, can take cache
+   entry locks without risk of deadlock. */
+static bool active;                     /* Is there a journal? */
+static struct journal_super super;      /* Superblock. */
+static size_t head;                     /* Log offset of next record. */
+static uint32_t next_seq;               /* Sequence number to commit. */
+static block_sector_t tx[JOURNAL_MAX_BLOCKS]; /* Running transaction. */
+static size_t tx_cnt;                   /* Number of sectors in TX. */
+static int handle_cnt;                  /* Updates in progress. */
+static bool commit_wanted;              /* Commit when HANDLE_CNT is 0? */
+static size_t map_blocks;               /* Sectors in the free map file. */
+static struct lock journal_lock;
+static struct condition room_cond;      /* Signaled when updates end. */
+static struct journal_desc desc;        /* For log I/O. */
+static struct journal_commit rec;       /* For log I/O. */
+static uint8_t *data;                   /* Transaction contents, for log
+                                           I/O as a single transfer. */
+
+/* Statistics. */
+static unsigned long long commit_cnt;   /* Transactions committed. */
+static unsigned long long logged_cnt;   /* Sectors written to the log. */
+static unsigned long long update_cnt;   /* Updates begun. */
+static unsigned long long checkpoint_cnt; /* Times the log was reset. */
+static unsigned long long stall_cnt;    /* Updates that waited for room. */
+static unsigned long long replay_cnt;   /* Transactions replayed. */
+
+static void init (void);
+static bool has_room (void);
+static void commit (void);
+static void checkpoint (void);
+static void write_super (void);
+static size_t replay (void);
+static void alloc_data (void);
+
+/* Reserves the log region on a newly formatted file system,
+   writes the journal superblock, and starts journaling. */
+void
+journal_create (void)
+{
+  memset (&super, 0, sizeof super);
+  super.magic = SUPER_MAGIC;
+  super.size = JOURNAL_SECTORS;
+  super.seq = 1;
+  if (!free_map_allocate (JOURNAL_SECTORS, &super.start))
+    PANIC ("journal creation failed");
+  init ();
+  write_super ();
+  head = 0;
+  next_seq = super.seq;
+  active = true;
+}
+
+/* Reads the journal superblock and replays any committed
+   transactions found in the log.  A file system formatted
+   without a journal is left without one.  Must be called before
+   any metadata is read through the buffer cache. */
+void
+journal_open (void)
+{
+  ASSERT (sizeof super == BLOCK_SECTOR_SIZE);
+  ASSERT (sizeof desc == BLOCK_SECTOR_SIZE);
+  ASSERT (sizeof rec == BLOCK_SECTOR_SIZE);
+
+  block_read (fs_device, JOURNAL_SECTOR, &super);
+  if (super.magic != SUPER_MAGIC)
+    return;
+
+  init ();
+  replay_cnt = replay ();
+  write_super ();
+  head = 0;
+  next_seq = super.seq;
+  active = true;
+}
+
+/* Commits the running transaction and resets the log, so that
+   the next startup has nothing to replay. */
+void
+journal_done (void)
+{
+  if (!active)
+    return;
+  lock_acquire (&journal_lock);
+  commit ();
+  checkpoint ();
+  lock_release (&journal_lock);
+}
+
+/* Starts a metadata update.  Updates may nest.  If the running
+   transaction might not have room for the update, waits until it
+   has been committed. */
+void
+journal_begin (void)
+{
+  struct thread *t = thread_current ();
+
+  if (!active || t->journal_depth++ > 0)
+    return;
+
+  lock_acquire (&journal_lock);
+  if (!has_room ())
+    {
+      stall_cnt++;
+      do
+        {
+          if (handle_cnt == 0)
+            commit ();
+          else
+            {
+              commit_wanted = true;
+              cond_wait (&room_cond, &journal_lock);
+            }
+        }
+      while (!has_room ());
+    }
+  handle_cnt++;
+  update_cnt++;
+  lock_release (&journal_lock);
+}
+
+/* Ends a metadata update started by journal_begin().  Commits the
+   running transaction if it is the last update in progress and
+   the transaction is big enough or a commit was requested. */
+void
+journal_end (void)
+{
+  struct thread *t = thread_current ();
+
+  if (t->journal_depth == 0 || --t->journal_depth > 0)
+    return;
+
+  lock_acquire (&journal_lock);
+  ASSERT (handle_cnt > 0);
+  if (--handle_cnt == 0 && (tx_cnt >= JOURNAL_COMMIT_BLOCKS || commit_wanted))
+    commit ();
+  cond_broadcast (&room_cond, &journal_lock);
+  lock_release (&journal_lock);
+}
+
+/* Adds SECTOR, which the current thread has just modified in the
+   buffer cache, to the running transaction.  Returns true if the
+   sector is now part of it, in which case the cache must not
+   write it home until journal_commit() releases it with
+   cache_unpin().  Returns false if the current thread is not in
+   an update.  Panics if the transaction is full, which means some
+   update modified more sectors than JOURNAL_UPDATE_BLOCKS. */
+bool
+journal_add (block_sector_t sector)
+{
+  bool added = false;
+  size_t i;
+
+  if (!active || thread_current ()->journal_depth == 0)
+    return false;
+
+  lock_acquire (&journal_lock);
+  for (i = 0; i < tx_cnt; i++)
+    if (tx[i] == sector)
+      {
+        added = true;
+        break;
+      }
+  if (!added)
+    {
+      if (tx_cnt >= JOURNAL_MAX_BLOCKS)
+        PANIC ("journal transaction overflow");
+      tx[tx_cnt++] = sector;
+      added = true;
+    }
+  lock_release (&journal_lock);
+  return added;
+}
+
+/* Commits the running transaction, or if updates are in progress,
+   arranges for the last of them to commit it.  Also resets the
+   log if that would let released sectors be reused. */
+void
+journal_commit (void)
+{
+  if (!active)
+    return;
+  lock_acquire (&journal_lock);
+  if (handle_cnt == 0)
+    {
+      commit ();
+      if (free_map_has_deferred ())
+        checkpoint ();
+    }
+  else
+    commit_wanted = true;
+  lock_release (&journal_lock);
+}
+
+/* Commits the running transaction and resets the log, first
+   waiting for the updates in progress to end, so that sectors
+   released since the last checkpoint can be reused.  Returns true
+   if successful, false if there is no journal or the current
+   thread is inside an update, which would keep the transaction
+   from ever committing. */
+bool
+journal_checkpoint (void)
+{
+  if (!active || thread_current ()->journal_depth > 0)
+    return false;
+
+  lock_acquire (&journal_lock);
+  while (handle_cnt > 0)
+    {
+      commit_wanted = true;
+      cond_wait (&room_cond, &journal_lock);
+    }
+  commit ();
+  checkpoint ();
+  lock_release (&journal_lock);
+  return true;
+}
+
+/* Returns true if the file system has a journal. */
+bool
+journal_active (void)
+{
+  return active;
+}
+
+/* Prints journal statistics. */
+void
+journal_print_stats (void)
+{
+  if (!active)
+    return;
+  printf ("Journal: %llu updates, %llu commits, %llu sectors logged, "
+          "%llu stalled, %llu checkpoints, %llu replayed\n",
+          update_cnt, commit_cnt, logged_cnt, stall_cnt, checkpoint_cnt,
+          replay_cnt);
+}
+
+/* Initializes the journal's locks and buffers.  Panics if the
+   free map is so big that an update could not fit in a
+   transaction. */
+static void
+init (void)
+{
+  map_blocks = DIV_ROUND_UP (block_size (fs_device), BLOCK_SECTOR_SIZE * 8);
+  if (JOURNAL_UPDATE_BLOCKS + map_blocks > JOURNAL_MAX_BLOCKS)
+    PANIC ("file system device too large for the journal");
+  lock_init (&journal_lock);
+  cond_init (&room_cond);
+  alloc_data ();
+}
+
+/* Returns true if the running transaction has room for one more
+   update besides those in progress.  Every sector of the free
+   map is counted as if it will join, since any update may write
+   any of them.  JOURNAL_LOCK must be held. */
+static bool
+has_room (void)
+{
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+
+  return (tx_cnt + (handle_cnt + 1) * JOURNAL_UPDATE_BLOCKS + map_blocks
+          <= JOURNAL_MAX_BLOCKS);
+}
+
+/* Appends the running transaction to the log and releases its
+   sectors to be written home.  Resets the log if another
+   transaction of the maximum size might not fit after this one.
+   JOURNAL_LOCK must be held and no updates may be in progress. */
+static void
+commit (void)
+{
+  uint32_t checksum = 0;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+  ASSERT (handle_cnt == 0);
+
+  commit_wanted = false;
+  if (tx_cnt == 0)
+    return;
+  ASSERT (head + tx_cnt + 2 <= super.size);
+
+  memset (&desc, 0, sizeof desc);
+  desc.magic = DESC_MAGIC;
+  desc.seq = next_seq;
+  desc.cnt = tx_cnt;
+  memcpy (desc.sectors, tx, tx_cnt * sizeof *tx);
+  block_write (fs_device, super.start + head, &desc);
+
+  for (i = 0; i < tx_cnt; i++)
+    {
+      uint8_t *sector = data + i * BLOCK_SECTOR_SIZE;
+      cache_read (tx[i], sector);
+      checksum = checksum * 31 + hash_bytes (sector, BLOCK_SECTOR_SIZE);
+    }
+  block_write_multi (fs_device, super.start + head + 1, tx_cnt, data);
+
+  memset (&rec, 0, sizeof rec);
+  rec.magic = COMMIT_MAGIC;
+  rec.seq = next_seq;
+  rec.checksum = checksum;
+  block_write (fs_device, super.start + head + 1 + tx_cnt, &rec);
+
+  for (i = 0; i < tx_cnt; i++)
+    cache_unpin (tx[i]);
+  head += tx_cnt + 2;
+  logged_cnt += tx_cnt;
+  commit_cnt++;
+  next_seq++;
+  tx_cnt = 0;
+
+  if (super.size - head < JOURNAL_MAX_BLOCKS + 2)
+    checkpoint ();
+}
+
+/* Writes every committed sector home and empties the log, then
+   lets sectors released since the last checkpoint be reused,
+   since no transaction that refers to them can be replayed any
+   more.  JOURNAL_LOCK must be held and no updates may be in
+   progress, so that no sector is held back by the running
+   transaction. */
+static void
+checkpoint (void)
+{
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+  ASSERT (tx_cnt == 0);
+
+  if (head > 0)
+    {
+      cache_flush ();
+      super.seq = next_seq;
+      head = 0;
+      write_super ();
+      checkpoint_cnt++;
+    }
+  free_map_release_deferred ();
+}
+
+/* Writes the journal superblock. */
+static void
+write_super (void)
+{
+  block_write (fs_device, JOURNAL_SECTOR, &super);
+}
+
+/* Copies each committed transaction in the log to its home
+   sectors, in order, and advances the superblock's sequence
+   number past them.  Returns the number of transactions
+   replayed. */
+static size_t
+replay (void)
+{
+  size_t pos = 0;
+  size_t cnt = 0;
+
+  while (pos + 2 <= super.size)
+    {
+      uint32_t checksum = 0;
+      size_t i;
+
+      /* Read and check the descriptor. */
+      block_read (fs_device, super.start + pos, &desc);
+      if (desc.magic != DESC_MAGIC || desc.seq != super.seq
+          || desc.cnt > JOURNAL_MAX_BLOCKS || pos + desc.cnt + 2 > super.size)
+        break;
+
+      /* Check that the whole transaction made it to disk. */
+      block_read_multi (fs_device, super.start + pos + 1, desc.cnt, data);
+      for (i = 0; i < desc.cnt; i++)
+        checksum = checksum * 31 + hash_bytes (data + i * BLOCK_SECTOR_SIZE,
+                                               BLOCK_SECTOR_SIZE);
+      block_read (fs_device, super.start + pos + 1 + desc.cnt, &rec);
+      if (rec.magic != COMMIT_MAGIC || rec.seq != desc.seq
+          || rec.checksum != checksum)
+        break;
+
+      /* Copy it home. */
+      for (i = 0; i < desc.cnt; i++)
+        block_write (fs_device, desc.sectors[i],
+                     data + i * BLOCK_SECTOR_SIZE);
+      pos += desc.cnt + 2;
+      super.seq++;
+      cnt++;
+    }
+  return cnt;
+}
+
+/* Allocates DATA, with room for the largest transaction. */
+static void
+alloc_data (void)
+{
+  size_t page_cnt = DIV_ROUND_UP (JOURNAL_MAX_BLOCKS * BLOCK_SECTOR_SIZE,
+                                  PGSIZE);
+  data = palloc_get_multiple (PAL_ASSERT, page_cnt);
+}
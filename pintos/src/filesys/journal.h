@@ -0,0 +1,21 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* Number of sectors in the log region. */
+#define JOURNAL_SECTORS 128
+
+void journal_create (void);
+void journal_open (void);
+void journal_done (void);
+void journal_begin (void);
+void journal_end (void);
+bool journal_add (block_sector_t);
+void journal_commit (void);
+bool journal_checkpoint (void);
+bool journal_active (void);
+void journal_print_stats (void);
+
+#endif /* filesys/journal.h */
@@ -0,0 +1,19 @@
+#ifndef __LIB_IOVEC_H
+#define __LIB_IOVEC_H
+
+/* Buffers for the readv() and writev() system calls, which
+   transfer several buffers to or from a file in one call. */
+
+#include <stddef.h>
+
+/* One buffer. */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Length of buffer in bytes. */
+  };
+
+/* Maximum number of buffers in one call. */
+#define IOV_MAX 64
+
+#endif /* lib/iovec.h */
@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($data) = join ('', map (chr (($_ * 257) & 0xff), 0...39999));
+check_archive ({"source" => [$data], "dest" => [$data . substr ($data, 1000)]});
+pass;
@@ -0,0 +1,66 @@
+/* Copies one file into another with copy_file_range, first
+   with both positions sector-aligned and then with positions
+   that are not aligned alike and a length that runs past the
+   end of the source, and checks the copy's checksum.  The file
+   is bigger than the buffer cache, so copying it makes the cache
+   evict while it holds entries for the copy.  Also checks that
+   overlapping ranges of one file are rejected. */
+
+#include <syscall.h>
+#include "tests/cksum.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE 40000
+
+static char buf[SIZE];
+static char readback[2 * SIZE - 1000];
+
+void
+test_main (void)
+{
+  int src, dst, src2;
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    buf[i] = i * 257;
+
+  CHECK (create ("source", 0), "create \"source\"");
+  CHECK (create ("dest", 0), "create \"dest\"");
+  CHECK ((src = open ("source")) > 1, "open \"source\"");
+  CHECK ((dst = open ("dest")) > 1, "open \"dest\"");
+  CHECK (write (src, buf, SIZE) == SIZE, "write \"source\"");
+
+  msg ("seek \"source\"");
+  seek (src, 0);
+  CHECK (copy_file_range (src, dst, SIZE) == SIZE, "copy whole file");
+  msg ("seek \"source\"");
+  seek (src, 1000);
+  CHECK (copy_file_range (src, dst, 2 * SIZE) == SIZE - 1000,
+         "copy past end of \"source\"");
+  if (tell (src) != SIZE || tell (dst) != sizeof readback)
+    fail ("positions %u and %u after copy, should be %d and %zu",
+          tell (src), tell (dst), SIZE, sizeof readback);
+  CHECK (copy_file_range (src, dst, 100) == 0, "copy at end of \"source\"");
+
+  CHECK ((src2 = open ("source")) > 1, "open \"source\" again");
+  msg ("seek \"source\"");
+  seek (src, 0);
+  seek (src2, 100);
+  CHECK (copy_file_range (src, src2, 500) == -1,
+         "copy overlapping range (must fail)");
+  CHECK (copy_file_range (src, 5678, 500) == -1, "copy to bad fd (must fail)");
+  msg ("close \"source\"");
+  close (src);
+  close (src2);
+
+  msg ("seek \"dest\"");
+  seek (dst, 0);
+  CHECK (read (dst, readback, sizeof readback) == sizeof readback,
+         "read \"dest\"");
+  msg ("cksum=%lu", cksum (readback, sizeof readback));
+  compare_bytes (readback, buf, SIZE, 0, "dest");
+  compare_bytes (readback + SIZE, buf + 1000, SIZE - 1000, SIZE, "dest");
+  msg ("close \"dest\"");
+  close (dst);
+}
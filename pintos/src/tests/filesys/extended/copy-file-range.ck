@@ -0,0 +1,31 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::cksum;
+my ($data) = join ('', map (chr (($_ * 257) & 0xff), 0...39999));
+my ($cksum) = cksum ($data . substr ($data, 1000));
+check_expected (IGNORE_EXIT_CODES => 1, [<<EOF]);
+(copy-file-range) begin
+(copy-file-range) create "source"
+(copy-file-range) create "dest"
+(copy-file-range) open "source"
+(copy-file-range) open "dest"
+(copy-file-range) write "source"
+(copy-file-range) seek "source"
+(copy-file-range) copy whole file
+(copy-file-range) seek "source"
+(copy-file-range) copy past end of "source"
+(copy-file-range) copy at end of "source"
+(copy-file-range) open "source" again
+(copy-file-range) seek "source"
+(copy-file-range) copy overlapping range (must fail)
+(copy-file-range) copy to bad fd (must fail)
+(copy-file-range) close "source"
+(copy-file-range) seek "dest"
+(copy-file-range) read "dest"
+(copy-file-range) cksum=$cksum
+(copy-file-range) close "dest"
+(copy-file-range) end
+EOF
+pass;
@@ -0,0 +1,38 @@
+/* Reserves space in a file with fallocate, which must not change
+   its length, then writes past the old end of file and checks
+   that the reserved gap reads back as zeros.  Also checks that
+   fallocate on a bad file descriptor fails. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[5678];
+
+void
+test_main (void)
+{
+  const char *file_name = "testfile";
+  int fd;
+
+  memset (buf, 'a', 600);
+  buf[sizeof buf - 1] = 'b';
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, 600) == 600, "write \"%s\"", file_name);
+  CHECK (fallocate (fd, 0, sizeof buf), "fallocate \"%s\"", file_name);
+  if (filesize (fd) != 600)
+    fail ("filesize %d after fallocate, should be 600", filesize (fd));
+  msg ("seek \"%s\"", file_name);
+  seek (fd, sizeof buf - 1);
+  CHECK (write (fd, buf + sizeof buf - 1, 1) == 1,
+         "write \"%s\" past old end of file", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+
+  CHECK (!fallocate (fd, 0, 512), "fallocate closed fd (must fail)");
+  CHECK (!fallocate (5678, 0, 512), "fallocate bad fd (must fail)");
+}
@@ -0,0 +1,20 @@
+/* Passes pread a buffer that straddles the bottom of the one-page
+   user stack, so that its first bytes lie in the unmapped page
+   below.  The process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  const char *file_name = "testfile";
+  int fd;
+
+  CHECK (create (file_name, 512), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  pread (fd, (char *) 0xbffff000 - 8, 16, 0);
+  fail ("should not have survived pread()");
+}
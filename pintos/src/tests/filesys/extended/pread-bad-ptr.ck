@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-bad-ptr) begin
+(pread-bad-ptr) create "testfile"
+(pread-bad-ptr) open "testfile"
+pread-bad-ptr: exit(-1)
+EOF
+pass;
@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($data) = join ('', map (chr (ord ('a') + $_ % 26), 0...999));
+substr ($data, 500, 200) = 'Z' x 200;
+check_archive ({"testfile" => [$data]});
+pass;
@@ -0,0 +1,63 @@
+/* Reads and writes a file at explicit offsets with pread and
+   pwrite and checks that neither moves the file position, that
+   pread is short at end of file, and that a bad file descriptor
+   fails. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[1000];
+static char readback[300];
+
+static void
+check_tell (int fd, unsigned ofs)
+{
+  unsigned pos = tell (fd);
+  if (pos != ofs)
+    fail ("file position moved: should be %u, actually %u", ofs, pos);
+}
+
+void
+test_main (void)
+{
+  const char *file_name = "testfile";
+  size_t i;
+  int fd;
+
+  for (i = 0; i < sizeof buf; i++)
+    buf[i] = 'a' + i % 26;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"%s\"", file_name);
+  msg ("seek \"%s\"", file_name);
+  seek (fd, 123);
+
+  memset (buf + 500, 'Z', 200);
+  CHECK (pwrite (fd, buf + 500, 200, 500) == 200,
+         "pwrite \"%s\" at 500", file_name);
+  check_tell (fd, 123);
+
+  CHECK (pread (fd, readback, 300, 400) == 300,
+         "pread \"%s\" at 400", file_name);
+  check_tell (fd, 123);
+  compare_bytes (readback, buf + 400, 300, 400, file_name);
+
+  CHECK (pread (fd, readback, 100, 950) == 50,
+         "pread \"%s\" across end of file", file_name);
+  compare_bytes (readback, buf + 950, 50, 950, file_name);
+  CHECK (pread (fd, readback, 100, 2000) == 0,
+         "pread \"%s\" past end of file", file_name);
+  check_tell (fd, 123);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+
+  CHECK (pread (fd, readback, 10, 0) == -1, "pread closed fd (must fail)");
+  CHECK (pwrite (fd, buf, 10, 0) == -1, "pwrite closed fd (must fail)");
+  CHECK (pread (5678, readback, 10, 0) == -1, "pread bad fd (must fail)");
+  CHECK (pwrite (5678, buf, 10, 0) == -1, "pwrite bad fd (must fail)");
+}
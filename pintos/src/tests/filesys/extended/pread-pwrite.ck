@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "testfile"
+(pread-pwrite) open "testfile"
+(pread-pwrite) write "testfile"
+(pread-pwrite) seek "testfile"
+(pread-pwrite) pwrite "testfile" at 500
+(pread-pwrite) pread "testfile" at 400
+(pread-pwrite) pread "testfile" across end of file
+(pread-pwrite) pread "testfile" past end of file
+(pread-pwrite) close "testfile"
+(pread-pwrite) open "testfile" for verification
+(pread-pwrite) verified contents of "testfile"
+(pread-pwrite) close "testfile"
+(pread-pwrite) pread closed fd (must fail)
+(pread-pwrite) pwrite closed fd (must fail)
+(pread-pwrite) pread bad fd (must fail)
+(pread-pwrite) pwrite bad fd (must fail)
+(pread-pwrite) end
+EOF
+pass;
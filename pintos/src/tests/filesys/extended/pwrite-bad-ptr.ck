@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pwrite-bad-ptr) begin
+(pwrite-bad-ptr) create "testfile"
+(pwrite-bad-ptr) open "testfile"
+pwrite-bad-ptr: exit(-1)
+EOF
+pass;
@@ -0,0 +1,26 @@
+/* Passes readv a list of buffers in which one points into
+   kernel memory.  The process must be terminated with -1 exit
+   code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[100];
+
+void
+test_main (void)
+{
+  const char *file_name = "testfile";
+  struct iovec iov[] =
+    {
+      {buf, sizeof buf}, {(char *) 0xc0100000, 123},
+    };
+  int fd;
+
+  CHECK (create (file_name, 512), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  readv (fd, iov, 2);
+  fail ("should not have survived readv()");
+}
@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_archive ({"testfile"
+		=> [join ('', map (chr (ord ('a') + $_ % 26), 0...1102))]});
+pass;
@@ -0,0 +1,64 @@
+/* Writes a file from several buffers with writev, including
+   empty ones, reads it back into a different set of buffers
+   with readv, and writes several buffers to the console with
+   writev. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[1103];
+static char readback[1300];
+
+void
+test_main (void)
+{
+  const char *file_name = "testfile";
+  struct iovec out[] =
+    {
+      {buf, 100}, {NULL, 0}, {buf + 100, 1000}, {buf + 1100, 3}, {buf, 0},
+    };
+  struct iovec in[] =
+    {
+      {readback, 7}, {readback + 7, 0}, {readback + 7, 1000},
+      {readback + 1007, 293},
+    };
+  struct iovec console[] =
+    {
+      {"(readv-writev) ", 15}, {"", 0}, {"writev to ", 10}, {"console\n", 8},
+    };
+  size_t i;
+  int fd;
+
+  for (i = 0; i < sizeof buf; i++)
+    buf[i] = 'a' + i % 26;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (writev (fd, out, sizeof out / sizeof *out) == sizeof buf,
+         "writev \"%s\"", file_name);
+  if (filesize (fd) != sizeof buf)
+    fail ("filesize %d after writev, should be %zu", filesize (fd),
+          sizeof buf);
+  if (tell (fd) != sizeof buf)
+    fail ("file position %u after writev, should be %zu", tell (fd),
+          sizeof buf);
+
+  msg ("seek \"%s\"", file_name);
+  seek (fd, 0);
+  CHECK (readv (fd, in, sizeof in / sizeof *in) == sizeof buf,
+         "readv \"%s\"", file_name);
+  compare_bytes (readback, buf, sizeof buf, 0, file_name);
+  CHECK (readv (fd, in, sizeof in / sizeof *in) == 0,
+         "readv \"%s\" at end of file", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+
+  if (writev (STDOUT_FILENO, console, sizeof console / sizeof *console) != 33)
+    fail ("writev to console should return 33");
+  CHECK (readv (fd, in, 1) == -1, "readv closed fd (must fail)");
+  CHECK (writev (fd, out, 1) == -1, "writev closed fd (must fail)");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "testfile"
+(readv-writev) open "testfile"
+(readv-writev) writev "testfile"
+(readv-writev) seek "testfile"
+(readv-writev) readv "testfile"
+(readv-writev) readv "testfile" at end of file
+(readv-writev) close "testfile"
+(readv-writev) open "testfile" for verification
+(readv-writev) verified contents of "testfile"
+(readv-writev) close "testfile"
+(readv-writev) writev to console
+(readv-writev) readv closed fd (must fail)
+(readv-writev) writev closed fd (must fail)
+(readv-writev) end
+EOF
+pass;
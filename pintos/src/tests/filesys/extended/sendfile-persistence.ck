@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($data) = join ('', map (sprintf ("sendfile test line %02d: ABCDEFGH\n", $_),
+			    0...40));
+check_archive ({"sendfile.txt" => [$data]});
+pass;
@@ -0,0 +1,51 @@
+/* Writes a text file, then sends all of it and then a range that
+   starts in the middle of a sector to the console with sendfile.
+   Neither length is a multiple of the sector size.  The console
+   output must match the file. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Each line is LINE_SIZE bytes long, newline included. */
+#define LINE_SIZE 32
+#define LINE_CNT 41
+
+static char buf[LINE_CNT * LINE_SIZE + 1];
+
+void
+test_main (void)
+{
+  const char *file_name = "sendfile.txt";
+  int fd, i;
+
+  for (i = 0; i < LINE_CNT; i++)
+    snprintf (buf + i * LINE_SIZE, LINE_SIZE + 1,
+              "sendfile test line %02d: ABCDEFGH\n", i);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, LINE_CNT * LINE_SIZE) == LINE_CNT * LINE_SIZE,
+         "write \"%s\"", file_name);
+
+  msg ("seek \"%s\"", file_name);
+  seek (fd, 0);
+  if (sendfile (fd, LINE_CNT * LINE_SIZE) != LINE_CNT * LINE_SIZE)
+    fail ("sendfile of whole file was short");
+  if (sendfile (fd, 100) != 0)
+    fail ("sendfile at end of file should return 0");
+
+  msg ("seek \"%s\"", file_name);
+  seek (fd, 22 * LINE_SIZE);
+  if (sendfile (fd, 11 * LINE_SIZE) != 11 * LINE_SIZE)
+    fail ("sendfile of lines 22 through 32 was short");
+  if (tell (fd) != 33 * LINE_SIZE)
+    fail ("file position %u after sendfile, should be %d",
+          tell (fd), 33 * LINE_SIZE);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (sendfile (fd, 100) == -1, "sendfile closed fd (must fail)");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my (@lines) = map (sprintf ("sendfile test line %02d: ABCDEFGH", $_), 0...40);
+check_expected (IGNORE_EXIT_CODES => 1, [join ('', map ("$_\n",
+  '(sendfile) begin',
+  '(sendfile) create "sendfile.txt"',
+  '(sendfile) open "sendfile.txt"',
+  '(sendfile) write "sendfile.txt"',
+  '(sendfile) seek "sendfile.txt"',
+  @lines,
+  '(sendfile) seek "sendfile.txt"',
+  @lines[22...32],
+  '(sendfile) close "sendfile.txt"',
+  '(sendfile) sendfile closed fd (must fail)',
+  '(sendfile) end'))]);
+pass;
@@ -0,0 +1,28 @@
+/* Passes writev more than IOV_MAX buffers.  The process must be
+   terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct iovec iov[IOV_MAX + 1];
+
+void
+test_main (void)
+{
+  const char *file_name = "testfile";
+  int fd;
+  int i;
+
+  for (i = 0; i < IOV_MAX + 1; i++)
+    {
+      iov[i].iov_base = "x";
+      iov[i].iov_len = 1;
+    }
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  writev (fd, iov, IOV_MAX + 1);
+  fail ("should not have survived writev()");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(writev-too-many) begin
+(writev-too-many) create "testfile"
+(writev-too-many) open "testfile"
+writev-too-many: exit(-1)
+EOF
+pass;
@@ -34,6 +34,9 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/ramdisk.h"
+#include "devices/stripe.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -49,6 +52,9 @@ static bool format_filesys;
    overriding the defaults. */
 static const char *filesys_bdev_name;
 static const char *scratch_bdev_name;
+
+/* -raid0: Members and stripe unit of a striped file system device. */
+static char *raid0_spec;
 #ifdef VM
 static const char *swap_bdev_name;
 #endif
@@ -122,7 +128,14 @@ main (void)
 
 #ifdef FILESYS
   /* Initialize file system. */
+  ramdisk_init ();
   ide_init ();
+  if (raid0_spec != NULL)
+    {
+      struct block *md = stripe_create (raid0_spec);
+      if (filesys_bdev_name == NULL)
+        filesys_bdev_name = block_name (md);
+    }
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
@@ -247,6 +260,14 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-ramdisk"))
+        ramdisk_configure (value);
+      else if (!strcmp (name, "-raid0"))
+        raid0_spec = value;
+      else if (!strcmp (name, "-flush-age"))
+        cache_configure (atoi (value), 0);
+      else if (!strcmp (name, "-dirty-ratio"))
+        cache_configure (0, atoi (value));
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
@@ -373,6 +394,11 @@ usage (void)
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -ramdisk=ROLE:KB   Use a KB kB RAM disk for ROLE by default.\n"
+          "  -raid0=BDEV,BDEV...[:UNIT]  Stripe file system over BDEVs\n"
+          "                     in UNIT-sector units (default 8).\n"
+          "  -flush-age=MS      Write back cached data after MS ms dirty.\n"
+          "  -dirty-ratio=PCT   Write back cache when over PCT%% dirty.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
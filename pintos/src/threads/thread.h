@@ -121,6 +121,10 @@ struct thread
     struct file *executable;
     struct list *fd_root;
     struct dir *working_dir;
+
+    /* Owned by filesys/journal.c. */
+    int journal_depth;                  /* Nesting of journal updates. */
+
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
   };
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "threads/malloc.h"
+#include "devices/block.h"
 #include "devices/input.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
@@ -897,6 +898,190 @@ fd_dir (int fd)
   return -1;
 }
 
+/* Returns the file open as FD in the current process, or a null
+   pointer if FD is not open or is a directory. */
+static struct file *
+fd_file (int fd)
+{
+  struct list_elem *e;
+  struct thread *curr_thread = thread_current ();
+  for (e = list_begin (curr_thread->fd_root); e != list_end (curr_thread->fd_root); e = list_next (e))
+    {
+      struct fd_elem *f = list_entry (e, struct fd_elem, table_elem);
+      if (f->fd == fd)
+        return f->file_ptr;
+    }
+  return NULL;
+}
+
+/* Reserves disk space for the LENGTH bytes starting at OFFSET in
+   the file open as FD, without changing its length, so that
+   writing them later does no allocation.  Returns false if FD is
+   not an open file, if writes to it are denied, or if the disk
+   fills up. */
+bool
+fallocate (int fd, unsigned offset, unsigned length)
+{
+  struct file *file = fd_file (fd);
+  if (file == NULL || offset > INT32_MAX || length > INT32_MAX - offset)
+    return false;
+  return file_reserve (file, length, offset);
+}
+
+/* Reads SIZE bytes at byte OFFSET of the file open as FD into
+   BUFFER, without using or moving the file position.  Returns
+   the number of bytes read, which is short at end of file, or -1
+   if FD is not an open file. */
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  struct file *file = fd_file (fd);
+  if (file == NULL || offset > INT32_MAX)
+    return -1;
+  if (size > INT32_MAX - offset)
+    size = INT32_MAX - offset;
+  return file_read_at (file, buffer, size, offset);
+}
+
+/* Writes SIZE bytes from BUFFER at byte OFFSET of the file open
+   as FD, extending it if necessary, without using or moving the
+   file position.  Returns the number of bytes written, which is
+   short if the disk fills up, or -1 if FD is not an open file
+   or the write would run past the largest possible file. */
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  struct file *file = fd_file (fd);
+  if (file == NULL || offset > INT32_MAX || size > INT32_MAX - offset)
+    return -1;
+  return file_write_at (file, buffer, size, offset);
+}
+
+/* Reads from the file open as FD into the IOV_CNT buffers in
+   IOV in turn, as read() does, until they are full or end of
+   file is reached.  Returns the number of bytes read, or -1 if
+   FD is not open for reading. */
+int
+readv (int fd, const struct iovec *iov, int iov_cnt)
+{
+  struct file *file;
+  int bytes_read = 0;
+  int i;
+
+  if (fd == 0)
+    {
+      for (i = 0; i < iov_cnt; i++)
+        {
+          uint8_t *base = iov[i].iov_base;
+          size_t j;
+
+          for (j = 0; j < iov[i].iov_len; j++)
+            base[j] = input_getc ();
+          bytes_read += iov[i].iov_len;
+        }
+      return bytes_read;
+    }
+  file = fd_file (fd);
+  if (file == NULL)
+    return -1;
+  return file_readv (file, iov, iov_cnt);
+}
+
+/* Writes the IOV_CNT buffers in IOV to the file open as FD, as
+   write() does, but as a single write, so that a file is
+   extended and its inode updated only once.  Returns the number
+   of bytes written, or -1 if FD is not open for writing or the
+   buffers add up to more than the largest file. */
+int
+writev (int fd, const struct iovec *iov, int iov_cnt)
+{
+  struct file *file;
+  size_t size = 0;
+  int i;
+
+  for (i = 0; i < iov_cnt; i++)
+    {
+      if (iov[i].iov_len > INT32_MAX - size)
+        return -1;
+      size += iov[i].iov_len;
+    }
+
+  if (fd == 1)
+    {
+      for (i = 0; i < iov_cnt; i++)
+        putbuf (iov[i].iov_base, iov[i].iov_len);
+      return size;
+    }
+  file = fd_file (fd);
+  if (file == NULL || size > (size_t) (INT32_MAX - file_tell (file)))
+    return -1;
+  return file_writev (file, iov, iov_cnt);
+}
+
+/* Copies up to SIZE bytes from the file open as FD_IN, starting
+   at its position, to the file open as FD_OUT at its position,
+   inside the kernel, and advances both positions.  Returns the
+   number of bytes copied, which is short at the end of FD_IN, or
+   -1 if either is not an open file or the two ranges overlap in
+   the same file. */
+int
+copy_file_range (int fd_in, int fd_out, unsigned size)
+{
+  struct file *in = fd_file (fd_in);
+  struct file *out = fd_file (fd_out);
+  off_t in_pos, out_pos;
+
+  if (in == NULL || out == NULL)
+    return -1;
+  in_pos = file_tell (in);
+  out_pos = file_tell (out);
+  if (size > (unsigned) (INT32_MAX - out_pos))
+    size = INT32_MAX - out_pos;
+  if (file_get_inode (in) == file_get_inode (out)
+      && (int64_t) in_pos < (int64_t) out_pos + size
+      && (int64_t) out_pos < (int64_t) in_pos + size)
+    return -1;
+  return file_copy (out, in, size);
+}
+
+/* Writes up to SIZE bytes from the file open as FD, starting at
+   its position, to the console, advancing the position.  The data
+   moves a sector at a time through a kernel buffer rather than
+   through user memory.  Returns the number of bytes written, which
+   is short at end of file, or -1 if FD is not an open file or the
+   buffer cannot be allocated. */
+int
+sendfile (int fd, unsigned size)
+{
+  struct file *file = fd_file (fd);
+  uint8_t *buffer;
+  unsigned bytes_sent = 0;
+
+  if (file == NULL)
+    return -1;
+  buffer = malloc (BLOCK_SECTOR_SIZE);
+  if (buffer == NULL)
+    return -1;
+  if (size > INT32_MAX)
+    size = INT32_MAX;
+  while (bytes_sent < size)
+    {
+      /* Keep reads sector-aligned in the file. */
+      off_t chunk = BLOCK_SECTOR_SIZE - file_tell (file) % BLOCK_SECTOR_SIZE;
+      off_t bytes_read;
+
+      if ((unsigned) chunk > size - bytes_sent)
+        chunk = size - bytes_sent;
+      bytes_read = file_read (file, buffer, chunk);
+      if (bytes_read <= 0)
+        break;
+      putbuf ((const char *) buffer, bytes_read);
+      bytes_sent += bytes_read;
+    }
+  free (buffer);
+  return bytes_sent;
+}
+
 bool
 is_dir (int fd)
   {
@@ -1,6 +1,7 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <iovec.h>
 #include "threads/thread.h"
 
 tid_t process_execute (const char *file_name);
@@ -21,5 +22,12 @@ int fd_inumber (int fd);
 struct inode* fd_inode (int fd);
 struct dir* fd_dir (int fd);
 bool is_dir (int fd);
+bool fallocate (int fd, unsigned offset, unsigned length);
+int pread (int fd, void *buffer, unsigned size, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned size, unsigned offset);
+int readv (int fd, const struct iovec *iov, int iov_cnt);
+int writev (int fd, const struct iovec *iov, int iov_cnt);
+int copy_file_range (int fd_in, int fd_out, unsigned size);
+int sendfile (int fd, unsigned size);
 
 #endif /* userprog/process.h */
@@ -28,6 +28,25 @@ is_valid_pointer (void* ptr)
   return is_user_vaddr (ptr + 3) && pagedir_get_page (thread_current()->pagedir, ptr);
 }
 
+/* Returns true if all SIZE bytes starting at BUFFER are mapped
+   user memory. */
+static bool
+is_valid_buffer (const void *buffer, unsigned size)
+{
+  const uint8_t *start = buffer;
+  const uint8_t *end = start + size;
+  const uint8_t *p;
+
+  if (size == 0)
+    return true;
+  if (end < start || !is_user_vaddr (end - 1))
+    return false;
+  for (p = pg_round_down (start); p < end; p += PGSIZE)
+    if (pagedir_get_page (thread_current ()->pagedir, p) == NULL)
+      return false;
+  return true;
+}
+
 static void
 invalid_access (struct intr_frame *f UNUSED)
 {
@@ -79,6 +98,68 @@ syscall_handler (struct intr_frame *f UNUSED)
           break;
         }
 
+      case SYS_PREAD:
+      case SYS_PWRITE:
+        {
+          if (!is_valid_pointer (f->esp + 16))
+            invalid_access (f);
+          if (!is_valid_buffer ((void *) args[2], args[3]))
+            invalid_access (f);
+          if (args[0] == SYS_PREAD)
+            f->eax = pread (args[1], (void *) args[2], args[3], args[4]);
+          else
+            f->eax = pwrite (args[1], (void *) args[2], args[3], args[4]);
+          break;
+        }
+
+      case SYS_READV:
+      case SYS_WRITEV:
+        {
+          const struct iovec *iov;
+          int iov_cnt;
+          int i;
+
+          if (!is_valid_pointer (f->esp + 12))
+            invalid_access (f);
+          iov = (const struct iovec *) args[2];
+          iov_cnt = args[3];
+          if (iov_cnt < 0 || iov_cnt > IOV_MAX
+              || !is_valid_buffer (iov, iov_cnt * sizeof *iov))
+            invalid_access (f);
+          for (i = 0; i < iov_cnt; i++)
+            if (!is_valid_buffer (iov[i].iov_base, iov[i].iov_len))
+              invalid_access (f);
+          if (args[0] == SYS_READV)
+            f->eax = readv (args[1], iov, iov_cnt);
+          else
+            f->eax = writev (args[1], iov, iov_cnt);
+          break;
+        }
+
+      case SYS_COPY_FILE_RANGE:
+        {
+          if (!is_valid_pointer (f->esp + 12))
+            invalid_access (f);
+          f->eax = copy_file_range (args[1], args[2], args[3]);
+          break;
+        }
+
+      case SYS_SENDFILE:
+        {
+          if (!is_valid_pointer (f->esp + 8))
+            invalid_access (f);
+          f->eax = sendfile (args[1], args[2]);
+          break;
+        }
+
+      case SYS_FALLOCATE:
+        {
+          if (!is_valid_pointer (f->esp + 12))
+            invalid_access (f);
+          f->eax = fallocate (args[1], args[2], args[3]);
+          break;
+        }
+
       case SYS_SEEK:
       case SYS_READDIR:
       case SYS_CREATE:
@@ -0,0 +1,833 @@
+/* pintos-mkfs: creates Pintos file system images on the host,
+   copying a host directory tree into them, and checks existing
+   images.
+
+   The image is the raw contents of a file system partition, as
+   taken by "pintos-mkdisk --filesys=IMAGE" or
+   "pintos --filesys=IMAGE".  Creating an image this way writes
+   exactly what the kernel would after formatting and extracting
+   the files, without booting it. */
+
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* On-disk format.  These must match filesys/filesys.h,
+   filesys/inode.c, filesys/directory.c, filesys/journal.c and the
+   bitmap file format of lib/kernel/bitmap.c. */
+#define SECTOR_SIZE 512
+
+#define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
+#define JOURNAL_SECTOR 1        /* Journal superblock sector. */
+#define ROOT_DIR_SECTOR 4       /* Root directory file inode sector. */
+
+#define INODE_MAGIC 0x494e4f44
+#define INODE_INDEXED 0         /* Direct, indirect, doubly indirect. */
+#define INODE_EXTENTS 1         /* Array of extents. */
+#define EXTENT_CNT 41
+#define DIRECT_CNT 123
+#define PTRS_PER_SECTOR (SECTOR_SIZE / sizeof (uint32_t))
+
+struct extent
+  {
+    uint32_t block;                     /* First file block. */
+    uint32_t start;                     /* First sector. */
+    uint32_t length;                    /* Number of sectors. */
+  };
+
+struct inode_disk
+  {
+    int32_t length;                     /* File size in bytes. */
+    uint8_t is_dir;                     /* Directory? */
+    uint8_t format;                     /* INODE_INDEXED or INODE_EXTENTS. */
+    union
+      {
+        struct                          /* INODE_INDEXED. */
+          {
+            uint32_t direct[DIRECT_CNT];
+            uint32_t indirect;
+            uint32_t doubly_indirect;
+          };
+        struct                          /* INODE_EXTENTS. */
+          {
+            uint32_t extent_cnt;
+            struct extent extents[EXTENT_CNT];
+          };
+      };
+    uint32_t magic;                     /* INODE_MAGIC. */
+  };
+
+#define PINTOS_NAME_MAX 14
+#define DIR_MAGIC 0x48444952            /* "HDIR". */
+#define DIR_MAX_BUCKETS 4096
+
+struct dir_entry
+  {
+    uint32_t inode_sector;              /* Sector number of header. */
+    char name[PINTOS_NAME_MAX + 1];     /* Null terminated file name. */
+    uint8_t in_use;                     /* In use or free? */
+  };
+
+#define ENTRIES_PER_BUCKET (SECTOR_SIZE / sizeof (struct dir_entry))
+
+struct dir_header
+  {
+    uint32_t magic;                     /* DIR_MAGIC. */
+    uint32_t bucket_cnt;                /* Number of buckets, a power of 2. */
+  };
+
+#define JOURNAL_SECTORS 128
+#define SUPER_MAGIC 0x4a524e4c          /* "JRNL". */
+#define DESC_MAGIC 0x4a444553           /* "JDES". */
+
+struct journal_super
+  {
+    uint32_t magic;                     /* SUPER_MAGIC. */
+    uint32_t start;                     /* First sector of the log. */
+    uint32_t size;                      /* Number of sectors in the log. */
+    uint32_t seq;                       /* Sequence number of the
+                                           transaction at the start
+                                           of the log. */
+  };
+
+struct journal_desc
+  {
+    uint32_t magic;                     /* DESC_MAGIC. */
+    uint32_t seq;                       /* Transaction sequence number. */
+  };
+
+static const char *program_name;
+
+/* The image, held in memory in its entirety. */
+static const char *image_name;
+static uint8_t *image;
+static uint32_t sector_cnt;
+
+/* Sectors in use, one bit per sector in the same layout as the
+   kernel's free map file. */
+static uint8_t *used;
+
+/* While creating: next sector to allocate. */
+static uint32_t next_sector;
+
+/* While checking: sectors referenced so far, number of problems
+   found, and counts of what was found. */
+static uint8_t *seen;
+static unsigned problem_cnt;
+static unsigned file_cnt, dir_cnt;
+
+static void usage (int exit_code) __attribute__ ((noreturn));
+static void fail (const char *, ...)
+  __attribute__ ((noreturn, format (printf, 1, 2)));
+
+/* Prints a message formatted from FORMAT to stderr and exits
+   with a failure status. */
+static void
+fail (const char *format, ...)
+{
+  va_list args;
+
+  fprintf (stderr, "%s: ", program_name);
+  va_start (args, format);
+  vfprintf (stderr, format, args);
+  va_end (args);
+  fputc ('\n', stderr);
+  exit (EXIT_FAILURE);
+}
+
+/* Returns a pointer to SECTOR of the image. */
+static void *
+sector_ptr (uint32_t sector)
+{
+  return image + (size_t) sector * SECTOR_SIZE;
+}
+
+static bool
+bit_test (const uint8_t *bits, uint32_t i)
+{
+  return (bits[i / 8] >> (i % 8)) & 1;
+}
+
+static void
+bit_set (uint8_t *bits, uint32_t i)
+{
+  bits[i / 8] |= 1 << (i % 8);
+}
+
+/* Returns the size in bytes of the free map file for the
+   image, which lib/kernel/bitmap.c rounds up to whole 32-bit
+   words. */
+static size_t
+free_map_bytes (void)
+{
+  return (sector_cnt + 31) / 32 * 4;
+}
+
+/* Returns the bucket for NAME in a directory with BUCKET_CNT
+   buckets, using the kernel's hash_string(). */
+static uint32_t
+bucket_of (const char *name, uint32_t bucket_cnt)
+{
+  const unsigned char *s = (const unsigned char *) name;
+  uint32_t hash = 2166136261u;
+
+  while (*s != '\0')
+    hash = (hash * 16777619u) ^ *s++;
+  return hash & (bucket_cnt - 1);
+}
+
+/* Creating images. */
+
+/* Allocates CNT consecutive sectors and returns the first. */
+static uint32_t
+allocate (uint32_t cnt)
+{
+  uint32_t first = next_sector;
+  uint32_t i;
+
+  if (cnt > sector_cnt - next_sector)
+    fail ("%s: file system is full", image_name);
+  for (i = 0; i < cnt; i++)
+    bit_set (used, first + i);
+  next_sector += cnt;
+  return first;
+}
+
+/* Writes an extent-format inode to SECTOR for a file of LENGTH
+   bytes held in the CNT sectors starting at START. */
+static void
+write_inode (uint32_t sector, int32_t length, bool is_dir,
+             uint32_t start, uint32_t cnt)
+{
+  struct inode_disk *d = sector_ptr (sector);
+
+  memset (d, 0, sizeof *d);
+  d->length = length;
+  d->is_dir = is_dir;
+  d->format = INODE_EXTENTS;
+  if (cnt > 0)
+    {
+      d->extent_cnt = 1;
+      d->extents[0].block = 0;
+      d->extents[0].start = start;
+      d->extents[0].length = cnt;
+    }
+  d->magic = INODE_MAGIC;
+}
+
+/* Copies host file NAME, which is SIZE bytes long, into a new
+   file in the image and returns its inode sector. */
+static uint32_t
+add_file (const char *name, off_t size)
+{
+  uint32_t cnt = (size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+  uint32_t sector = allocate (1 + cnt);
+  FILE *file;
+
+  if (size > INT32_MAX)
+    fail ("%s: too large for a Pintos file", name);
+  file = fopen (name, "rb");
+  if (file == NULL)
+    fail ("%s: open: %s", name, strerror (errno));
+  if (fread (sector_ptr (sector + 1), 1, size, file) != (size_t) size)
+    fail ("%s: read failed", name);
+  fclose (file);
+
+  write_inode (sector, size, false, sector + 1, cnt);
+  return sector;
+}
+
+/* Writes a hashed directory holding the CNT entries in ENTRIES
+   with its inode in SECTOR, using as few buckets as the kernel's
+   dir_create() and split_buckets() would allow. */
+static void
+write_dir (uint32_t sector, const struct dir_entry *entries, size_t cnt)
+{
+  uint32_t bucket_cnt = 1;
+  size_t *fill = NULL;
+  struct dir_header *h;
+  uint32_t start;
+  size_t i;
+
+  while (bucket_cnt * ENTRIES_PER_BUCKET < cnt)
+    bucket_cnt *= 2;
+
+  /* Double the bucket count until every bucket has room. */
+  for (;;)
+    {
+      bool fits = true;
+
+      if (bucket_cnt > DIR_MAX_BUCKETS)
+        fail ("%s: directory with %zu entries is too large",
+              image_name, cnt);
+      free (fill);
+      fill = calloc (bucket_cnt, sizeof *fill);
+      if (fill == NULL)
+        fail ("out of memory");
+      for (i = 0; i < cnt && fits; i++)
+        fits = ++fill[bucket_of (entries[i].name, bucket_cnt)]
+               <= ENTRIES_PER_BUCKET;
+      if (fits)
+        break;
+      bucket_cnt *= 2;
+    }
+
+  start = allocate (1 + bucket_cnt);
+  h = sector_ptr (start);
+  h->magic = DIR_MAGIC;
+  h->bucket_cnt = bucket_cnt;
+  memset (fill, 0, bucket_cnt * sizeof *fill);
+  for (i = 0; i < cnt; i++)
+    {
+      uint32_t b = bucket_of (entries[i].name, bucket_cnt);
+      struct dir_entry *bucket = sector_ptr (start + 1 + b);
+      bucket[fill[b]++] = entries[i];
+    }
+  free (fill);
+
+  write_inode (sector, (1 + bucket_cnt) * SECTOR_SIZE, true,
+               start, 1 + bucket_cnt);
+}
+
+/* Adds entry NAME for the inode in SECTOR to the array of *CNT
+   entries in *ENTRIES, which has room for *CAP. */
+static void
+add_entry (struct dir_entry **entries, size_t *cnt, size_t *cap,
+           const char *name, uint32_t sector)
+{
+  struct dir_entry *e;
+
+  if (*cnt == *cap)
+    {
+      *cap = *cap > 0 ? *cap * 2 : 16;
+      *entries = realloc (*entries, *cap * sizeof **entries);
+      if (*entries == NULL)
+        fail ("out of memory");
+    }
+  e = &(*entries)[(*cnt)++];
+  memset (e, 0, sizeof *e);
+  e->inode_sector = sector;
+  strcpy (e->name, name);
+  e->in_use = true;
+}
+
+/* Writes a directory with its inode in SECTOR and its parent's
+   in PARENT, holding a copy of host directory NAME if NAME is
+   non-null and otherwise empty.  The root directory, unlike the
+   others, has no "." and ".." entries, as in the kernel. */
+static void
+add_dir (const char *name, uint32_t sector, uint32_t parent)
+{
+  struct dir_entry *entries = NULL;
+  size_t cnt = 0, cap = 0;
+  DIR *dir;
+  struct dirent *de;
+
+  if (sector != ROOT_DIR_SECTOR)
+    {
+      add_entry (&entries, &cnt, &cap, ".", sector);
+      add_entry (&entries, &cnt, &cap, "..", parent);
+    }
+
+  dir = name != NULL ? opendir (name) : NULL;
+  if (name != NULL && dir == NULL)
+    fail ("%s: opendir: %s", name, strerror (errno));
+  while (dir != NULL && (de = readdir (dir)) != NULL)
+    {
+      char *path;
+      struct stat st;
+
+      if (!strcmp (de->d_name, ".") || !strcmp (de->d_name, ".."))
+        continue;
+      if (strlen (de->d_name) > PINTOS_NAME_MAX)
+        fail ("%s/%s: name longer than %d characters",
+              name, de->d_name, PINTOS_NAME_MAX);
+
+      path = malloc (strlen (name) + strlen (de->d_name) + 2);
+      if (path == NULL)
+        fail ("out of memory");
+      sprintf (path, "%s/%s", name, de->d_name);
+      if (stat (path, &st) < 0)
+        fail ("%s: stat: %s", path, strerror (errno));
+
+      if (S_ISDIR (st.st_mode))
+        {
+          uint32_t child = allocate (1);
+          add_dir (path, child, sector);
+          add_entry (&entries, &cnt, &cap, de->d_name, child);
+          dir_cnt++;
+        }
+      else if (S_ISREG (st.st_mode))
+        {
+          add_entry (&entries, &cnt, &cap, de->d_name,
+                     add_file (path, st.st_size));
+          file_cnt++;
+        }
+      else
+        fprintf (stderr, "%s: %s: not a file or directory, skipping\n",
+                 program_name, path);
+      free (path);
+    }
+  if (dir != NULL)
+    closedir (dir);
+
+  write_dir (sector, entries, cnt);
+  free (entries);
+}
+
+/* Formats the image and copies host directory TREE, if non-null,
+   into its root directory. */
+static void
+make_fs (const char *tree)
+{
+  struct journal_super *super;
+  uint32_t fm_cnt, fm_start;
+  uint32_t i;
+
+  /* Sectors 0 through ROOT_DIR_SECTOR are reserved. */
+  for (i = 0; i <= ROOT_DIR_SECTOR; i++)
+    bit_set (used, i);
+  next_sector = ROOT_DIR_SECTOR + 1;
+
+  fm_cnt = (free_map_bytes () + SECTOR_SIZE - 1) / SECTOR_SIZE;
+  fm_start = allocate (fm_cnt);
+
+  super = sector_ptr (JOURNAL_SECTOR);
+  super->magic = SUPER_MAGIC;
+  super->start = allocate (JOURNAL_SECTORS);
+  super->size = JOURNAL_SECTORS;
+  super->seq = 1;
+
+  add_dir (tree, ROOT_DIR_SECTOR, ROOT_DIR_SECTOR);
+
+  /* Write the free map last, now that everything is allocated. */
+  memcpy (sector_ptr (fm_start), used, free_map_bytes ());
+  write_inode (FREE_MAP_SECTOR, free_map_bytes (), false, fm_start, fm_cnt);
+}
+
+/* Checking images. */
+
+/* Reports a problem with the image. */
+static void problem (const char *, ...)
+  __attribute__ ((format (printf, 1, 2)));
+static void
+problem (const char *format, ...)
+{
+  va_list args;
+
+  printf ("%s: ", image_name);
+  va_start (args, format);
+  vprintf (format, args);
+  va_end (args);
+  putchar ('\n');
+  problem_cnt++;
+}
+
+/* Records that SECTOR is in use by the file named NAME.
+   Returns false, after reporting a problem, if SECTOR is out of
+   range or already in use. */
+static bool
+claim (uint32_t sector, const char *name)
+{
+  if (sector >= sector_cnt)
+    {
+      problem ("%s: sector %"PRIu32" past end of device", name, sector);
+      return false;
+    }
+  if (bit_test (seen, sector))
+    {
+      problem ("%s: sector %"PRIu32" is also used elsewhere", name, sector);
+      return false;
+    }
+  bit_set (seen, sector);
+  return true;
+}
+
+/* Returns the sector of index block SECTOR's entry I, or 0 if
+   SECTOR is 0 or out of range. */
+static uint32_t
+index_entry (uint32_t sector, size_t i)
+{
+  if (sector == 0 || sector >= sector_cnt)
+    return 0;
+  return ((uint32_t *) sector_ptr (sector))[i];
+}
+
+/* Returns the sector that holds block INDEX of the file whose
+   inode is D, or 0 if it is a hole or out of range. */
+static uint32_t
+block_sector (const struct inode_disk *d, size_t index)
+{
+  uint32_t sector = 0;
+  size_t i;
+
+  if (d->format == INODE_EXTENTS)
+    {
+      for (i = 0; i < d->extent_cnt && i < EXTENT_CNT; i++)
+        if (index >= d->extents[i].block
+            && index - d->extents[i].block < d->extents[i].length)
+          sector = d->extents[i].start + (index - d->extents[i].block);
+    }
+  else if (index < DIRECT_CNT)
+    sector = d->direct[index];
+  else if (index < DIRECT_CNT + PTRS_PER_SECTOR)
+    sector = index_entry (d->indirect, index - DIRECT_CNT);
+  else
+    {
+      index -= DIRECT_CNT + PTRS_PER_SECTOR;
+      if (index < PTRS_PER_SECTOR * PTRS_PER_SECTOR)
+        sector = index_entry (index_entry (d->doubly_indirect,
+                                           index / PTRS_PER_SECTOR),
+                              index % PTRS_PER_SECTOR);
+    }
+  return sector < sector_cnt ? sector : 0;
+}
+
+/* Reads SIZE bytes at byte offset OFS of the file whose inode is
+   D into BUFFER, treating holes as zeros. */
+static void
+read_at (const struct inode_disk *d, void *buffer_, size_t size, size_t ofs)
+{
+  uint8_t *buffer = buffer_;
+
+  while (size > 0)
+    {
+      uint32_t sector = block_sector (d, ofs / SECTOR_SIZE);
+      size_t sector_ofs = ofs % SECTOR_SIZE;
+      size_t chunk = SECTOR_SIZE - sector_ofs < size
+                     ? SECTOR_SIZE - sector_ofs : size;
+
+      if (sector != 0)
+        memcpy (buffer, (uint8_t *) sector_ptr (sector) + sector_ofs, chunk);
+      else
+        memset (buffer, 0, chunk);
+      buffer += chunk;
+      ofs += chunk;
+      size -= chunk;
+    }
+}
+
+/* Claims every sector in index block SECTOR of file NAME and, if
+   DEPTH is 2, in the index blocks it points to. */
+static void
+claim_index (uint32_t sector, int depth, const char *name)
+{
+  size_t i;
+
+  if (sector == 0 || !claim (sector, name))
+    return;
+  for (i = 0; i < PTRS_PER_SECTOR; i++)
+    {
+      uint32_t child = index_entry (sector, i);
+      if (depth > 1)
+        claim_index (child, depth - 1, name);
+      else if (child != 0)
+        claim (child, name);
+    }
+}
+
+/* Checks the inode in SECTOR of the file named NAME and claims
+   its sectors.  Returns the inode, or a null pointer if it is
+   unusable. */
+static const struct inode_disk *
+check_inode (uint32_t sector, const char *name)
+{
+  const struct inode_disk *d;
+  uint32_t i;
+
+  if (!claim (sector, name))
+    return NULL;
+  d = sector_ptr (sector);
+  if (d->magic != INODE_MAGIC)
+    {
+      problem ("%s: inode %"PRIu32" has bad magic number", name, sector);
+      return NULL;
+    }
+  if (d->length < 0)
+    problem ("%s: negative length %"PRId32, name, d->length);
+
+  if (d->format == INODE_EXTENTS)
+    {
+      if (d->extent_cnt > EXTENT_CNT)
+        {
+          problem ("%s: %"PRIu32" extents", name, d->extent_cnt);
+          return NULL;
+        }
+      for (i = 0; i < d->extent_cnt; i++)
+        {
+          const struct extent *x = &d->extents[i];
+          uint32_t j;
+
+          if (i > 0 && x->block < x[-1].block + x[-1].length)
+            problem ("%s: extent %"PRIu32" out of order", name, i);
+          for (j = 0; j < x->length; j++)
+            if (!claim (x->start + j, name))
+              break;
+        }
+    }
+  else if (d->format == INODE_INDEXED)
+    {
+      for (i = 0; i < DIRECT_CNT; i++)
+        if (d->direct[i] != 0)
+          claim (d->direct[i], name);
+      claim_index (d->indirect, 1, name);
+      claim_index (d->doubly_indirect, 2, name);
+    }
+  else
+    {
+      problem ("%s: unknown inode format %d", name, d->format);
+      return NULL;
+    }
+  return d;
+}
+
+static void check_dir (const struct inode_disk *, uint32_t sector,
+                       uint32_t parent, const char *name);
+
+/* Checks directory entry E, found in the directory with its inode
+   in SECTOR, whose own parent's is in PARENT, and named NAME. */
+static void
+check_entry (const struct dir_entry *e, uint32_t sector, uint32_t parent,
+             const char *name)
+{
+  const struct inode_disk *d;
+  char *path;
+
+  if (memchr (e->name, '\0', sizeof e->name) == NULL || e->name[0] == '\0')
+    {
+      problem ("%s: entry with bad name", name);
+      return;
+    }
+  if (!strcmp (e->name, "."))
+    {
+      if (e->inode_sector != sector)
+        problem ("%s: \".\" does not point to itself", name);
+      return;
+    }
+  if (!strcmp (e->name, ".."))
+    {
+      if (e->inode_sector != parent)
+        problem ("%s: \"..\" does not point to its parent", name);
+      return;
+    }
+
+  path = malloc (strlen (name) + strlen (e->name) + 2);
+  if (path == NULL)
+    fail ("out of memory");
+  sprintf (path, "%s%s%s", name, name[strlen (name) - 1] == '/' ? "" : "/",
+           e->name);
+  d = check_inode (e->inode_sector, path);
+  if (d != NULL && d->is_dir)
+    {
+      dir_cnt++;
+      check_dir (d, e->inode_sector, sector, path);
+    }
+  else if (d != NULL)
+    file_cnt++;
+  free (path);
+}
+
+/* Checks the entries of directory D, with its inode in SECTOR
+   and its parent's in PARENT, named NAME. */
+static void
+check_dir (const struct inode_disk *d, uint32_t sector, uint32_t parent,
+           const char *name)
+{
+  struct dir_header h;
+  struct dir_entry e;
+  size_t ofs;
+
+  read_at (d, &h, sizeof h, 0);
+  if (h.magic != DIR_MAGIC)
+    {
+      /* Linear directory. */
+      for (ofs = 0; ofs + sizeof e <= (size_t) d->length; ofs += sizeof e)
+        {
+          read_at (d, &e, sizeof e, ofs);
+          if (e.in_use)
+            check_entry (&e, sector, parent, name);
+        }
+    }
+  else if (h.bucket_cnt == 0 || (h.bucket_cnt & (h.bucket_cnt - 1)) != 0
+           || h.bucket_cnt > DIR_MAX_BUCKETS
+           || (size_t) d->length < (1 + h.bucket_cnt) * SECTOR_SIZE)
+    problem ("%s: bad bucket count %"PRIu32, name, h.bucket_cnt);
+  else
+    {
+      uint32_t b;
+      size_t i;
+
+      for (b = 0; b < h.bucket_cnt; b++)
+        for (i = 0; i < ENTRIES_PER_BUCKET; i++)
+          {
+            read_at (d, &e, sizeof e, (b + 1) * SECTOR_SIZE + i * sizeof e);
+            e.name[PINTOS_NAME_MAX] = '\0';
+
+            /* Skip entries left behind by a bucket split. */
+            if (e.in_use && bucket_of (e.name, h.bucket_cnt) == b)
+              check_entry (&e, sector, parent, name);
+          }
+    }
+}
+
+/* Checks the image and returns true if no problems were found. */
+static bool
+check_fs (void)
+{
+  const struct journal_super *super = sector_ptr (JOURNAL_SECTOR);
+  const struct inode_disk *fm, *root;
+  uint8_t *free_map;
+  uint32_t i, used_cnt = 0, leaked_cnt = 0;
+
+  for (i = 0; i <= ROOT_DIR_SECTOR; i++)
+    if (i != FREE_MAP_SECTOR && i != ROOT_DIR_SECTOR)
+      claim (i, "(reserved)");
+
+  if (super->magic == SUPER_MAGIC)
+    {
+      const struct journal_desc *desc;
+
+      for (i = 0; i < super->size; i++)
+        if (!claim (super->start + i, "(journal)"))
+          break;
+      desc = super->start < sector_cnt ? sector_ptr (super->start) : NULL;
+      if (desc != NULL && desc->magic == DESC_MAGIC
+          && desc->seq == super->seq)
+        printf ("%s: journal holds transactions not yet replayed; "
+                "results may be stale\n", image_name);
+    }
+
+  fm = check_inode (FREE_MAP_SECTOR, "(free map)");
+  if (fm == NULL)
+    return false;
+  if ((size_t) fm->length < free_map_bytes ())
+    {
+      problem ("(free map): only %"PRId32" bytes long", fm->length);
+      return false;
+    }
+  free_map = malloc (free_map_bytes ());
+  if (free_map == NULL)
+    fail ("out of memory");
+  read_at (fm, free_map, free_map_bytes (), 0);
+
+  root = check_inode (ROOT_DIR_SECTOR, "/");
+  if (root != NULL && !root->is_dir)
+    problem ("/: root is not a directory");
+  else if (root != NULL)
+    check_dir (root, ROOT_DIR_SECTOR, ROOT_DIR_SECTOR, "/");
+
+  for (i = 0; i < sector_cnt; i++)
+    if (bit_test (seen, i))
+      {
+        used_cnt++;
+        if (!bit_test (free_map, i))
+          problem ("sector %"PRIu32" is in use but marked free", i);
+      }
+    else if (bit_test (free_map, i))
+      leaked_cnt++;
+  free (free_map);
+
+  printf ("%s: %u files, %u directories, %"PRIu32" of %"PRIu32
+          " sectors in use", image_name, file_cnt, dir_cnt, used_cnt,
+          sector_cnt);
+  if (leaked_cnt > 0)
+    printf (", %"PRIu32" more marked in use but unreferenced", leaked_cnt);
+  printf ("\n");
+  return problem_cnt == 0;
+}
+
+static void
+usage (int exit_code)
+{
+  printf ("pintos-mkfs, for creating and checking Pintos file system "
+          "images\n"
+          "Usage: %s [-s SIZE] IMAGE [DIR]\n"
+          "  Creates IMAGE, SIZE MB in size (default 2), holding a copy\n"
+          "  of the files and directories in host directory DIR.\n"
+          "Usage: %s -c IMAGE\n"
+          "  Checks the consistency of IMAGE.\n"
+          "IMAGE is the raw contents of a file system partition, for use\n"
+          "with \"pintos-mkdisk --filesys=IMAGE\".\n",
+          program_name, program_name);
+  exit (exit_code);
+}
+
+int
+main (int argc, char *argv[])
+{
+  double size_mb = 2.0;
+  bool check = false;
+  FILE *file;
+  int opt;
+
+  program_name = argv[0];
+  while ((opt = getopt (argc, argv, "s:ch")) != -1)
+    switch (opt)
+      {
+      case 's':
+        size_mb = strtod (optarg, NULL);
+        break;
+      case 'c':
+        check = true;
+        break;
+      case 'h':
+        usage (EXIT_SUCCESS);
+      default:
+        usage (EXIT_FAILURE);
+      }
+  if (check ? argc - optind != 1 : argc - optind < 1 || argc - optind > 2)
+    usage (EXIT_FAILURE);
+  image_name = argv[optind];
+
+  if (check)
+    {
+      long size;
+
+      file = fopen (image_name, "rb");
+      if (file == NULL || fseek (file, 0, SEEK_END) < 0
+          || (size = ftell (file)) < 0)
+        fail ("%s: %s", image_name, strerror (errno));
+      sector_cnt = size / SECTOR_SIZE;
+      rewind (file);
+    }
+  else
+    sector_cnt = size_mb * 1024 * 1024 / SECTOR_SIZE;
+  if (sector_cnt < ROOT_DIR_SECTOR + 1 + JOURNAL_SECTORS + 8)
+    fail ("%s: too small for a file system", image_name);
+
+  image = calloc (sector_cnt, SECTOR_SIZE);
+  used = calloc (1, free_map_bytes ());
+  seen = calloc (1, free_map_bytes ());
+  if (image == NULL || used == NULL || seen == NULL)
+    fail ("out of memory");
+
+  if (check)
+    {
+      bool ok;
+
+      if (fread (image, SECTOR_SIZE, sector_cnt, file) != sector_cnt)
+        fail ("%s: read failed", image_name);
+      fclose (file);
+      ok = check_fs ();
+      return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+  make_fs (optind + 1 < argc ? argv[optind + 1] : NULL);
+  file = fopen (image_name, "wb");
+  if (file == NULL)
+    fail ("%s: %s", image_name, strerror (errno));
+  if (fwrite (image, SECTOR_SIZE, sector_cnt, file) != sector_cnt
+      || fclose (file) != 0)
+    fail ("%s: write failed", image_name);
+  printf ("%s: %u files, %u directories, %"PRIu32" of %"PRIu32
+          " sectors in use\n", image_name, file_cnt, dir_cnt, next_sector,
+          sector_cnt);
+  return EXIT_SUCCESS;
+}